@@ -32,6 +32,10 @@ typedef struct {
     
     // Respawn configuration - how many of each type should always be available
     int target_counts[PET_TYPE_COUNT];
+
+    // One reference per type kept for the manager's lifetime, so the shared
+    // textures stay cached while pets are caught and respawned
+    Sprite type_sprites[PET_TYPE_COUNT];
 } PetManager;
 
 // Initialize pet system with target counts for each pet type
@@ -1,21 +1,42 @@
 #ifndef DIALOGUE_H
 #define DIALOGUE_H
 
+#include "hal/residency.h"
 #include <SDL2/SDL.h>
 #include <SDL2/SDL_ttf.h>   // required for TTF_Font
 #include <stdbool.h>
 
+#define DIALOGUE_MAX_TEXT 2048
+#define DIALOGUE_MAX_GLYPHS 1024
+
+// One UTF-8 code point of the laid-out dialogue text
+typedef struct
+{
+    int offset;   // byte offset into Dialogue.text
+    int length;   // UTF-8 byte length
+    int x, y;     // position inside the text canvas
+    bool visible; // false for spaces and line breaks
+} DialogueGlyph;
+
 typedef struct
 {
     bool active;
     bool finished;
 
-    const char *full_text;
-    char shown_text[2048];
-    int text_index;
+    char text[DIALOGUE_MAX_TEXT];   // owned copy of the current text
+    DialogueGlyph glyphs[DIALOGUE_MAX_GLYPHS];
+    int glyph_count;
+    int text_index;                 // glyphs revealed by the typewriter
+    int glyphs_drawn;               // glyphs already composited into the canvas
     Uint32 last_char_time;
+    bool timer_started;             // last_char_time set by the first update
+
+    // persistent text layer: glyphs are appended as they are revealed
+    SDL_Surface *text_canvas;
+    SDL_Texture *text_texture;
+    int text_height;                // rows of the canvas in use
 
-    SDL_Texture *texture;
+    ResidentTexture portrait;       // full-window dialogue box image
     SDL_Renderer *renderer;
 
     TTF_Font *font;        // dialogue font
@@ -27,7 +48,7 @@ extern Dialogue g_dialogue;
 // function initializations
 void dialogue_init(SDL_Renderer *renderer);
 void dialogue_start(const char *text);
-void dialogue_update_typewriter(void);
+void dialogue_update_typewriter(Uint32 now); // now: game time in ms
 void dialogue_handle_key(SDL_Keycode key);
 void dialogue_render(SDL_Renderer *renderer);
 bool dialogue_is_active(void);
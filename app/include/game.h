@@ -1,7 +1,29 @@
 #ifndef GAME_H
 #define GAME_H
 
+#include "hal/display.h"
+#include "hal/frame_scheduler.h"
+#include <stddef.h>
+
+// Run-time options, parsed from the command line in main.c
+typedef struct
+{
+    FrameMode frame_mode; // how frames are paced
+    int target_fps;       // rate for fixed mode
+    DisplayMode display_mode;
+    int max_frames;       // quit after this many frames (0 = run until quit)
+    const char *record_path; // record input to this file (NULL = off)
+    const char *replay_path; // play input back from this file (NULL = off)
+    const char *pack_path;   // asset pack to map (loose files when missing)
+    const char *access_log_path; // write asset first-use order here on exit (NULL = off)
+    size_t texture_budget;   // bytes of reloadable textures kept on the GPU
+    int audio_buffer_frames; // mixer buffer size, the sound effect latency (0 = adaptive)
+} GameOptions;
+
+// Fill options with the defaults (fixed pacing at TARGET_FPS, assets.pak)
+void game_options_defaults(GameOptions *options);
+
 // Main game loop - runs until player quits (ctrl + c / esc)
-void game_run(void);
+void game_run(const GameOptions *options);
 
-#endif // GAME_H
\ No newline at end of file
+#endif // GAME_H
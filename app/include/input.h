@@ -2,6 +2,7 @@
 #define INPUT_H
 
 #include <stdbool.h>
+#include <stdint.h>
 #include <SDL2/SDL.h>
 #include "hal/joystick.h"
 #include "hal/button.h"
@@ -15,23 +16,98 @@ typedef enum
     INPUT_RIGHT
 } InputDirection;
 
+// Identifies one input for latency measurement: a sequence number and the
+// CLOCK_MONOTONIC time the device took it (SPI read, GPIO edge, or the SDL
+// key event). id 0 means no new input.
+typedef struct
+{
+    unsigned long id;
+    uint64_t time_ns;
+} InputStamp;
+
+// Everything the player can hold down, on any device
+typedef enum
+{
+    INPUT_BUTTON_UP,
+    INPUT_BUTTON_DOWN,
+    INPUT_BUTTON_LEFT,
+    INPUT_BUTTON_RIGHT,
+    INPUT_BUTTON_CATCH,
+    INPUT_BUTTON_INTERACT,
+    INPUT_BUTTON_RESET,
+    INPUT_BUTTON_COUNT
+} InputButton;
+
+// Events kept per snapshot; more in one frame are dropped (and counted)
+#define INPUT_MAX_EVENTS 32
+
+typedef struct
+{
+    InputButton button;
+    bool pressed;      // false: released
+    InputStamp stamp;  // when the device saw it
+} InputEvent;
+
+// What the player did since the previous frame
+typedef struct
+{
+    unsigned held;                       // bit (1u << InputButton) per held button
+    InputEvent events[INPUT_MAX_EVENTS]; // presses and releases, oldest first
+    int event_count;
+    InputStamp click_stamp;              // left click (id 0 when none)
+} InputSnapshot;
+
+// Everything the game loop reads from the player in one frame. Filled from
+// the devices, or from a recording when a replay is playing.
+typedef struct
+{
+    Uint32 time_ms;           // game time of the frame
+    InputDirection direction;
+    bool catch_pressed;       // edges, true only on the frame of the press
+    bool interact_pressed;
+    bool reset_pressed;
+    bool clicked;             // left mouse click this frame
+    int click_x;              // logical coordinates of the click
+    int click_y;
+
+    // inputs that arrived for this frame (not recorded in replays)
+    InputStamp direction_stamp; // the direction changed
+    InputStamp catch_stamp;
+    InputStamp interact_stamp;
+    InputStamp reset_stamp;     // reset button, or the click on host
+} FrameInput;
+
 // Initialize input system (auto-detects joystick or keyboard)
 bool input_initialize(void);
 
-// Get current input direction
-InputDirection input_get_direction(void);
+// Wake the event loop (hal/event_loop.h) on joystick and button changes;
+// returns false when no hardware input is in use
+bool input_register_wakeups(void);
+
+// Slow the joystick sampler while the game sleeps on input and the stick
+// rests; restores the full rate otherwise
+void input_set_idle(bool idle);
+
+// Queue key presses/releases and clicks as SDL delivers them; call for
+// every event before input_capture
+void input_handle_event(const SDL_Event *event);
+
+// Take everything that happened since the previous capture, from the
+// keyboard events, the joystick and the buttons. Once per frame; every
+// consumer reads the snapshot instead of the devices.
+void input_capture(InputSnapshot *snapshot);
 
-// Check if catch button is pressed (existing function)
-bool input_is_catch_pressed(bool *last_state);
+bool input_is_held(const InputSnapshot *snapshot, InputButton button);
 
-// Check if interact button is pressed
-bool input_is_interact_pressed(bool *last_state);
+// First press of button in the snapshot's queue (NULL when none)
+const InputEvent *input_first_press(const InputSnapshot *snapshot, InputButton button);
 
-bool input_is_reset_pressed(bool *last_state);
+// Held direction (up, down, left, right take precedence in that order),
+// or the last one tapped during the frame when none is held
+InputDirection input_snapshot_direction(const InputSnapshot *snapshot);
 
-// add prototypes
-void input_poll_once_per_frame(void);
-bool input_button_just_pressed_cached(void);
+// Fill in the live fields of a frame (all but time and click) from a snapshot
+void input_read_frame(const InputSnapshot *snapshot, FrameInput *frame);
 
 // Cleanup input system
 void input_cleanup(void);
@@ -2,6 +2,7 @@
 #define MAP_H
 #include "common.h"
 #include "npc.h"
+#include "hal/residency.h"
 #include <SDL2/SDL.h>
 #include <stdbool.h>
 
@@ -44,8 +45,13 @@ typedef struct
     NPC npcs[MAX_NPCS_PER_ROOM];
     int npc_count;
 
-    // background texture
-    SDL_Texture *background_texture;
+    // background image, loaded and evicted by the residency manager
+    ResidentTexture background;
+
+    // background, doors and NPCs baked into one texture while the room is
+    // current (built by rendering_draw_room_static)
+    SDL_Texture *static_layer;
+    bool static_dirty;
 } Room;
 
 typedef struct
@@ -71,6 +77,12 @@ void map_render_background(Map *map, SDL_Renderer *renderer);
 
 void map_render_debug_grid(SDL_Renderer *renderer);
 
+// Rebuild the room's static layer on its next draw (e.g. an NPC was caught)
+void map_mark_static_dirty(Room *room);
+
+// Mark every static layer for rebuild (render-target contents were lost)
+void map_invalidate_static_layers(Map *map);
+
 // Cleanup all map resources
 void map_cleanup(Map *map);
 
@@ -4,6 +4,10 @@
 #include <stdbool.h>
 #include "map.h"
 
+// Tracks the game starts with, opened behind the splash screen
+#define MUSIC_MAIN_HALL_PATH "assets/music/main_hall.ogg"
+#define MUSIC_ENCOUNTER_PATH "assets/music/matthew.ogg"
+
 // Initialize music system and preload all tracks
 bool music_init(void);
 
@@ -0,0 +1,39 @@
+#ifndef PREFETCH_H
+#define PREFETCH_H
+
+#include "map.h"
+#include <SDL2/SDL.h>
+#include <stdbool.h>
+
+// Manhattan distance (tiles) from a door at which its target room is warmed
+#define PREFETCH_DOOR_DISTANCE 5
+
+typedef struct
+{
+    unsigned long requests; // rooms handed to the worker
+
+    // whether a room's assets were ready when the player came through a door
+    unsigned long texture_hits;
+    unsigned long texture_misses;
+    unsigned long music_hits;
+    unsigned long music_misses;
+} PrefetchStats;
+
+// Start the prefetch worker. With prefetch_music false only backgrounds are
+// warmed (e.g. when audio failed to open).
+bool prefetch_init(SDL_Renderer *renderer, bool prefetch_music);
+
+// Once per frame: queue the target room of every door the player is close
+// to, and upload a background the worker has finished decoding
+void prefetch_update(Map *map, int player_x, int player_y);
+
+// Count hits / misses for a room the player just entered (call before its
+// background and music are used)
+void prefetch_room_entered(Room *room);
+
+void prefetch_get_stats(PrefetchStats *stats);
+
+// Stop the worker and print the totals (before audio and residency cleanup)
+void prefetch_cleanup(void);
+
+#endif // PREFETCH_H
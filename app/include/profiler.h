@@ -0,0 +1,65 @@
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#include <SDL2/SDL.h>
+#include <stdbool.h>
+
+// Number of frames kept in the history ring
+#define PROFILER_HISTORY 240
+
+// Phases of one iteration of the game loop, in the order they run
+typedef enum
+{
+    PROFILE_EVENTS,  // SDL event polling
+    PROFILE_INPUT,   // input_capture
+    PROFILE_MUSIC,   // music_update
+    PROFILE_UPDATE,  // dialogue, catching, movement, room transitions
+    PROFILE_RENDER,  // building the frame (excluding text rasterization)
+    PROFILE_TEXT,    // text rasterization on text-cache misses
+    PROFILE_PRESENT, // display_present
+    PROFILE_WAIT,    // frame pacing sleep
+    PROFILE_PHASE_COUNT
+} ProfilePhase;
+
+typedef struct
+{
+    double average_ms[PROFILE_PHASE_COUNT];
+    double p99_ms[PROFILE_PHASE_COUNT];
+    double frame_average_ms;
+    double frame_p99_ms;
+    int frames; // frames in the history
+} ProfilerSummary;
+
+// Reset the history and start timing
+void profiler_init(void);
+
+// Start a new frame (closes the previous one)
+void profiler_begin_frame(void);
+
+// Attribute the time since the previous mark to phase
+void profiler_mark(ProfilePhase phase);
+
+// Current high-resolution timestamp, for profiler_add_nested
+Uint64 profiler_now(void);
+
+// Attribute time spent inside another phase (e.g. text rasterization during
+// rendering) to phase; it is subtracted from the enclosing phase's mark
+void profiler_add_nested(ProfilePhase phase, Uint64 start);
+
+// Averages and 99th percentiles over the history
+void profiler_get_summary(ProfilerSummary *summary);
+
+// Show or hide the overlay
+void profiler_toggle_overlay(void);
+bool profiler_overlay_visible(void);
+
+// Report the overlay area to the display's damage tracking
+void profiler_mark_damage(void);
+
+// Draw the frame-time graph and per-phase table (no-op when hidden)
+void profiler_draw_overlay(SDL_Renderer *renderer);
+
+// Print the per-phase summary
+void profiler_cleanup(void);
+
+#endif // PROFILER_H
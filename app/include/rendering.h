@@ -5,6 +5,7 @@
 #include "player.h"
 #include "npc.h"
 #include "map.h"
+#include "catch.h"
 
 
 // function initializations
@@ -14,4 +15,13 @@ void rendering_draw_doors(Door *doors, int door_count);
 void rendering_draw_obstacles(int obstacles[GRID_HEIGHT][GRID_WIDTH]);
 void rendering_draw_quest(SDL_Renderer* renderer);
 
+// Draw the room's background, doors and NPCs as one copy of its cached
+// static layer, rebuilding the layer first when it is dirty
+void rendering_draw_room_static(SDL_Renderer *renderer, Map *map, Room *room);
+
+// Compare the scene with the previous frame and report what moved or changed
+// to the display's damage tracking. overlay is true while a full-screen
+// dialogue is drawn over the world.
+void rendering_mark_damage(Room *room, PetManager *pets, Player *player, bool overlay);
+
 #endif
\ No newline at end of file
@@ -10,6 +10,13 @@ bool rendering_ui_init(void);
 // Draw the HUD with animal counts and reset button
 void rendering_ui_draw_hud(PetManager* manager);
 
+// Force the cached HUD layer to be rebuilt on the next draw
+// (e.g. after SDL_RENDER_TARGETS_RESET)
+void rendering_ui_mark_dirty(void);
+
+// Report the HUD area to the display's damage tracking if it changed
+void rendering_ui_mark_damage(void);
+
 // Check if reset button was clicked (call with mouse click coords)
 bool rendering_ui_check_reset_click(int mouse_x, int mouse_y);
 
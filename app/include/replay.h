@@ -0,0 +1,26 @@
+#ifndef REPLAY_H
+#define REPLAY_H
+
+#include "input.h"
+#include <stdbool.h>
+
+// Start recording every frame's input to path; seed is stored so the
+// replay can reproduce random spawns
+bool replay_record_open(const char *path, unsigned int seed);
+
+// Open a recording for playback; returns the seed it was recorded with
+bool replay_play_open(const char *path, unsigned int *seed);
+
+bool replay_is_recording(void);
+bool replay_is_playing(void);
+
+// Append one frame of input (recording only)
+void replay_record_frame(const FrameInput *frame);
+
+// Read the next recorded frame; false once the recording is exhausted
+bool replay_next_frame(FrameInput *frame);
+
+// Finish the file (recording) or release it (playback)
+void replay_close(void);
+
+#endif // REPLAY_H
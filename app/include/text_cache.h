@@ -0,0 +1,61 @@
+#ifndef TEXT_CACHE_H
+#define TEXT_CACHE_H
+
+#include <SDL2/SDL.h>
+#include <SDL2/SDL_ttf.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+// Default GPU byte budget for cached text textures (4 MB)
+#define TEXT_CACHE_DEFAULT_BUDGET (4u * 1024u * 1024u)
+
+typedef struct
+{
+    // cumulative counters since text_cache_init
+    unsigned long hits;
+    unsigned long misses;
+    unsigned long evictions;
+    unsigned long uncached; // textures larger than the whole budget
+
+    // counters for the last completed frame (see text_cache_end_frame)
+    unsigned int frame_hits;
+    unsigned int frame_misses;
+
+    size_t bytes_used;
+    size_t byte_budget;
+    int entry_count;
+} TextCacheStats;
+
+// Initialize the text cache for a renderer with a texture byte budget
+bool text_cache_init(SDL_Renderer *renderer, size_t byte_budget);
+
+// Get a ready texture for (font, text, color, wrap width).
+// wrap_width <= 0 renders a single line. The texture stays owned by the
+// cache and is only valid until the next text_cache_get call that misses.
+// A texture larger than the whole budget is returned without being cached.
+SDL_Texture *text_cache_get(TTF_Font *font, const char *text, SDL_Color color,
+                            int wrap_width, int *out_w, int *out_h);
+
+// Size of the text without rasterizing it or counting a hit or miss (for
+// layout and damage tracking). Unwrapped text that is not cached yet is
+// measured with the font; wrapped text only once it is cached.
+bool text_cache_measure(TTF_Font *font, const char *text, SDL_Color color,
+                        int wrap_width, int *out_w, int *out_h);
+
+// Draw cached text with its top-left corner at (x, y)
+bool text_cache_draw(TTF_Font *font, const char *text, SDL_Color color,
+                     int wrap_width, int x, int y);
+
+// Close the per-frame hit/miss counters (call once per frame after present)
+void text_cache_end_frame(void);
+
+// Read cache counters
+void text_cache_get_stats(TextCacheStats *stats);
+
+// Drop every cached texture (e.g. when fonts are about to be closed)
+void text_cache_clear(void);
+
+// Cleanup text cache resources
+void text_cache_cleanup(void);
+
+#endif // TEXT_CACHE_H
@@ -3,7 +3,6 @@
 #include "quest.h"
 #include <stdio.h>
 #include <stdlib.h>
-#include <time.h>
 
 // Pet sprite paths
 static const char* PET_SPRITE_PATHS[] = {
@@ -62,8 +61,6 @@ static bool find_random_spawn_position(Map* map, int room_id, int* out_x, int* o
 
 void pet_manager_init(PetManager* manager, SDL_Renderer* renderer,
                       int bear_count, int raccoon_count, int deer_count, int bigdeer_count) {
-    (void)renderer; // Will be used in pet_spawn_initial
-    
     manager->count = 0;
     manager->total_caught = 0;
     
@@ -77,8 +74,14 @@ void pet_manager_init(PetManager* manager, SDL_Renderer* renderer,
         manager->pets[i].caught = true; // Mark all as caught initially
     }
     
-    // Seed random number generator
-    srand(time(NULL));
+    // Pin each pet texture once; spawns and respawns then share it
+    for (int type = 0; type < PET_TYPE_COUNT; type++) {
+        if (!sprite_load(&manager->type_sprites[type], renderer, PET_SPRITE_PATHS[type])) {
+            fprintf(stderr, "Pet Manager: Failed to load sprite for %s\n", PET_NAMES[type]);
+        }
+    }
+    
+    // rand() is seeded by game_run so replays reproduce the same spawns
     
     printf("Pet Manager: Initialized (Bear:%d, Raccoon:%d, Deer:%d, BigDeer:%d)\n",
            bear_count, raccoon_count, deer_count, bigdeer_count);
@@ -109,7 +112,7 @@ void pet_spawn_initial(PetManager* manager, SDL_Renderer* renderer, Map* map) {
             pet->id = manager->count;
             pet->caught = false;
             
-            // Load sprite
+            // Load sprite (shared with the pinned type sprite)
             if (!sprite_load(&pet->sprite, renderer, PET_SPRITE_PATHS[type])) {
                 fprintf(stderr, "Pet Manager: Failed to load sprite for %s\n", PET_NAMES[type]);
                 continue;
@@ -157,7 +160,7 @@ void pet_check_respawn(PetManager* manager, SDL_Renderer* renderer, Map* map) {
                 pet->id = manager->count;
                 pet->type = (PetType)type;
                 
-                // Load sprite for new pet
+                // Take a reference to the cached sprite (no disk access)
                 if (!sprite_load(&pet->sprite, renderer, PET_SPRITE_PATHS[type])) {
                     fprintf(stderr, "Pet Manager: Failed to load sprite for %s\n", PET_NAMES[type]);
                     continue;
@@ -271,18 +274,18 @@ void pet_render_all(PetManager* manager, SDL_Renderer* renderer, int current_roo
             
             // Draw white highlight if adjacent
             if (is_adjacent) {
-                SDL_SetRenderDrawColor(renderer, 255, 255, 255, 255);
+                SDL_Color white = {255, 255, 255, 255};
                 SDL_Rect highlight = {
                     pixel_x - 2,
                     pixel_y - 2,
                     TILE_SIZE + 4,
                     TILE_SIZE + 4
                 };
-                SDL_RenderFillRect(renderer, &highlight);
+                sprite_batch_fill_rect(renderer, &highlight, white);
             }
             
             // Render pet sprite
-            sprite_render(&pet->sprite, renderer, pixel_x, pixel_y);
+            sprite_batch_draw(&pet->sprite, renderer, pixel_x, pixel_y);
         }
     }
 }
@@ -295,5 +298,8 @@ void pet_manager_cleanup(PetManager* manager) {
     for (int i = 0; i < manager->count; i++) {
         sprite_free(&manager->pets[i].sprite);
     }
+    for (int type = 0; type < PET_TYPE_COUNT; type++) {
+        sprite_free(&manager->type_sprites[type]);
+    }
     printf("Pet Manager: Cleanup complete\n");
 }
\ No newline at end of file
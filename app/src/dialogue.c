@@ -1,6 +1,7 @@
 #include "dialogue.h"
+#include "common.h"
+#include "hal/asset_pack.h"
 #include <SDL2/SDL.h>
-#include <SDL2/SDL_image.h>
 #include <SDL2/SDL_ttf.h>
 #include <string.h>
 #include <stdio.h>
@@ -11,30 +12,200 @@
 #define TEXT_Y 870
 #define MAX_LINE_WIDTH 1750
 
+#define TEXT_CANVAS_W (MAX_LINE_WIDTH + 64)  // room for glyph overhang
+#define TEXT_CANVAS_H (WINDOW_HEIGHT - TEXT_Y)
+#define TYPEWRITER_DELAY_MS 35
+
 Dialogue g_dialogue = {0};
 
-// render text to the screen using the specific dialogue font
-static void render_text(SDL_Renderer *renderer, const char *text)
+static const SDL_Color TEXT_COLOR = {46, 18, 18, 255};
+
+// byte length of the UTF-8 sequence starting at s (invalid bytes count as 1)
+static int utf8_length(const char *s)
 {
-    if (!g_dialogue.font)
+    unsigned char c = (unsigned char)s[0];
+    int len = 1;
+
+    if ((c & 0xE0) == 0xC0)
+        len = 2;
+    else if ((c & 0xF0) == 0xE0)
+        len = 3;
+    else if ((c & 0xF8) == 0xF0)
+        len = 4;
+
+    // never step over the terminator on truncated input
+    for (int i = 1; i < len; i++)
+    {
+        if (s[i] == '\0')
+            return i;
+    }
+    return len;
+}
+
+// pixel width of the first len bytes of text
+static int measure_text(const char *text, int len)
+{
+    char buf[DIALOGUE_MAX_TEXT];
+    int w = 0;
+
+    memcpy(buf, text, len);
+    buf[len] = '\0';
+
+    if (TTF_SizeUTF8(g_dialogue.font, buf, &w, NULL) < 0)
+        return 0;
+    return w;
+}
+
+// wraps g_dialogue.text at MAX_LINE_WIDTH and places every code point.
+// Runs once per dialogue; the typewriter then only composites glyphs.
+static void layout_text(void)
+{
+    const char *text = g_dialogue.text;
+    int line_skip = TTF_FontLineSkip(g_dialogue.font);
+    int line_start = 0;   // byte offset of the current line
+    int last_space = -1;  // last break opportunity on the current line
+    int line = 0;
+    int first_glyph = 0;  // first glyph of the current line
+
+    g_dialogue.glyph_count = 0;
+
+    for (int i = 0; text[i] != '\0' && g_dialogue.glyph_count < DIALOGUE_MAX_GLYPHS;)
+    {
+        int len = utf8_length(&text[i]);
+        DialogueGlyph *g = &g_dialogue.glyphs[g_dialogue.glyph_count++];
+
+        g->offset = i;
+        g->length = len;
+        g->visible = !(text[i] == ' ' || text[i] == '\n');
+        g->x = 0;
+        g->y = line * line_skip;
+
+        if (text[i] == '\n')
+        {
+            line++;
+            line_start = i + 1;
+            last_space = -1;
+            first_glyph = g_dialogue.glyph_count;
+            i += len;
+            continue;
+        }
+
+        if (text[i] == ' ')
+            last_space = i;
+
+        // word wrap: move the words after the last space onto a new line
+        if (g->visible && last_space > line_start &&
+            measure_text(&text[line_start], i + len - line_start) > MAX_LINE_WIDTH)
+        {
+            line++;
+            line_start = last_space + 1;
+            last_space = -1;
+
+            while (first_glyph < g_dialogue.glyph_count &&
+                   g_dialogue.glyphs[first_glyph].offset < line_start)
+                first_glyph++;
+
+            for (int k = first_glyph; k < g_dialogue.glyph_count; k++)
+                g_dialogue.glyphs[k].y = line * line_skip;
+        }
+
+        i += len;
+    }
+
+    // x positions from the measured prefix of each line (keeps kerning)
+    int line_first = 0;
+    for (int k = 0; k < g_dialogue.glyph_count; k++)
+    {
+        DialogueGlyph *g = &g_dialogue.glyphs[k];
+
+        if (k > 0 && g_dialogue.glyphs[k - 1].y != g->y)
+            line_first = k;
+
+        int start = g_dialogue.glyphs[line_first].offset;
+        g->x = (g->offset > start) ? measure_text(&text[start], g->offset - start) : 0;
+    }
+}
+
+// composites revealed glyphs into the canvas and uploads only their rects
+static void draw_revealed_glyphs(void)
+{
+    while (g_dialogue.glyphs_drawn < g_dialogue.text_index)
+    {
+        DialogueGlyph *g = &g_dialogue.glyphs[g_dialogue.glyphs_drawn++];
+
+        if (!g->visible || !g_dialogue.font || !g_dialogue.text_canvas)
+            continue;
+
+        char cp[5];
+        memcpy(cp, &g_dialogue.text[g->offset], g->length);
+        cp[g->length] = '\0';
+
+        SDL_Surface *glyph = TTF_RenderUTF8_Blended(g_dialogue.font, cp, TEXT_COLOR);
+        if (!glyph)
+            continue;
+
+        SDL_Rect dst = {g->x, g->y, glyph->w, glyph->h};
+        SDL_SetSurfaceBlendMode(glyph, SDL_BLENDMODE_BLEND);
+        SDL_BlitSurface(glyph, NULL, g_dialogue.text_canvas, &dst); // dst is clipped
+        SDL_FreeSurface(glyph);
+
+        if (dst.w <= 0 || dst.h <= 0)
+            continue;
+
+        SDL_Surface *canvas = g_dialogue.text_canvas;
+        const Uint8 *pixels = (const Uint8 *)canvas->pixels + dst.y * canvas->pitch + dst.x * 4;
+        SDL_UpdateTexture(g_dialogue.text_texture, &dst, pixels, canvas->pitch);
+
+        if (dst.y + dst.h > g_dialogue.text_height)
+            g_dialogue.text_height = dst.y + dst.h;
+    }
+}
+
+// clears the part of the canvas used by the previous dialogue
+static void clear_text_canvas(void)
+{
+    if (!g_dialogue.text_canvas || g_dialogue.text_height <= 0)
         return;
 
-    SDL_Color red = {46, 18, 18, 255};
+    SDL_Rect used = {0, 0, TEXT_CANVAS_W, g_dialogue.text_height};
+    SDL_FillRect(g_dialogue.text_canvas, &used, 0);
+    SDL_UpdateTexture(g_dialogue.text_texture, &used,
+                      g_dialogue.text_canvas->pixels, g_dialogue.text_canvas->pitch);
+    g_dialogue.text_height = 0;
+}
 
-    // create text surface
-    SDL_Surface *surf = TTF_RenderUTF8_Blended_Wrapped(
-        g_dialogue.font, text, red, MAX_LINE_WIDTH
-    );
-    if (!surf) return;
+// creates the persistent canvas + streaming texture the text is appended to
+static void create_text_layer(SDL_Renderer *renderer)
+{
+    g_dialogue.text_canvas = SDL_CreateRGBSurfaceWithFormat(
+        0, TEXT_CANVAS_W, TEXT_CANVAS_H, 32, SDL_PIXELFORMAT_ARGB8888);
+    if (!g_dialogue.text_canvas)
+    {
+        printf("Dialogue canvas error: %s\n", SDL_GetError());
+        return;
+    }
+    SDL_FillRect(g_dialogue.text_canvas, NULL, 0);
 
-    // convert surface to texture for rendering
-    SDL_Texture *tex = SDL_CreateTextureFromSurface(renderer, surf);
+    g_dialogue.text_texture = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_ARGB8888,
+                                                SDL_TEXTUREACCESS_STREAMING,
+                                                TEXT_CANVAS_W, TEXT_CANVAS_H);
+    if (!g_dialogue.text_texture)
+    {
+        printf("Dialogue texture error: %s\n", SDL_GetError());
+        SDL_FreeSurface(g_dialogue.text_canvas);
+        g_dialogue.text_canvas = NULL;
+        return;
+    }
 
-    SDL_Rect dst = {TEXT_X, TEXT_Y, surf->w, surf->h};
-    SDL_FreeSurface(surf);
+    SDL_UpdateTexture(g_dialogue.text_texture, NULL,
+                      g_dialogue.text_canvas->pixels, g_dialogue.text_canvas->pitch);
 
-    SDL_RenderCopy(renderer, tex, NULL, &dst);
-    SDL_DestroyTexture(tex);
+    // blending glyphs onto a transparent canvas leaves premultiplied colour
+    SDL_BlendMode premultiplied = SDL_ComposeCustomBlendMode(
+        SDL_BLENDFACTOR_ONE, SDL_BLENDFACTOR_ONE_MINUS_SRC_ALPHA, SDL_BLENDOPERATION_ADD,
+        SDL_BLENDFACTOR_ONE, SDL_BLENDFACTOR_ONE_MINUS_SRC_ALPHA, SDL_BLENDOPERATION_ADD);
+    if (SDL_SetTextureBlendMode(g_dialogue.text_texture, premultiplied) < 0)
+        SDL_SetTextureBlendMode(g_dialogue.text_texture, SDL_BLENDMODE_BLEND);
 }
 
 // initializes the dialogue system
@@ -46,19 +217,24 @@ void dialogue_init(SDL_Renderer *renderer)
         printf("TTF Init error: %s\n", TTF_GetError());
 
     // Dialogue font (large)
-    g_dialogue.font = TTF_OpenFont(FONT_PATH, FONT_SIZE);
+    g_dialogue.font = TTF_OpenFontRW(asset_open(FONT_PATH), 1, FONT_SIZE);
     if (!g_dialogue.font)
         printf("Font load error: %s\n", TTF_GetError());
 
     // quest font (smaller UI font)
-    g_dialogue.quest_font = TTF_OpenFont(FONT_PATH, 55);   // <-- adjust size here
+    g_dialogue.quest_font = TTF_OpenFontRW(asset_open(FONT_PATH), 1, 55);   // <-- adjust size here
     if (!g_dialogue.quest_font)
         printf("Quest font load error: %s\n", TTF_GetError());
 
-    // Load default dialogue box image
-    g_dialogue.texture = IMG_LoadTexture(renderer, "assets/dialogue/navidDialogue.png");
-    if (!g_dialogue.texture)
-        printf("Failed to load initial PNG: %s\n", IMG_GetError());
+    create_text_layer(renderer);
+
+    // Default dialogue box image
+    // Portraits cover the whole window; they are loaded at output resolution
+    // when first shown and stay resident while the budget allows
+    g_dialogue.portrait = residency_register("assets/dialogue/navidDialogue.png",
+                                             WINDOW_WIDTH, WINDOW_HEIGHT);
+    if (g_dialogue.portrait == RESIDENT_NONE)
+        printf("Failed to register initial PNG\n");
 }
 
 // starts a new dialogue sequence with typewriter effect
@@ -66,33 +242,42 @@ void dialogue_start(const char *text)
 {
     g_dialogue.active = true;
     g_dialogue.finished = false;
-    g_dialogue.full_text = text;
+
+    // keep our own copy: callers often pass stack buffers
+    snprintf(g_dialogue.text, sizeof(g_dialogue.text), "%s", text ? text : "");
+
+    clear_text_canvas();
+    g_dialogue.glyph_count = 0;
+    if (g_dialogue.font)
+        layout_text();
 
     g_dialogue.text_index = 0;
-    g_dialogue.shown_text[0] = '\0';
-    g_dialogue.last_char_time = SDL_GetTicks();
+    g_dialogue.glyphs_drawn = 0;
+    g_dialogue.finished = (g_dialogue.glyph_count == 0);
+    g_dialogue.timer_started = false; // starts on the next update
 }
 
-// updates the typewriter effect for the dialogue
-void dialogue_update_typewriter(void)
+// updates the typewriter effect for the dialogue (one code point per step)
+void dialogue_update_typewriter(Uint32 now)
 {
     if (!g_dialogue.active || g_dialogue.finished)
         return;
 
-    Uint32 now = SDL_GetTicks();
-    if (now - g_dialogue.last_char_time > 35)
+    // game time rather than SDL_GetTicks, so replays type at the same pace
+    if (!g_dialogue.timer_started)
+    {
+        g_dialogue.last_char_time = now;
+        g_dialogue.timer_started = true;
+    }
+    if (now - g_dialogue.last_char_time > TYPEWRITER_DELAY_MS)
     {
         g_dialogue.last_char_time = now;
-
-        g_dialogue.shown_text[g_dialogue.text_index] =
-            g_dialogue.full_text[g_dialogue.text_index];
 
         g_dialogue.text_index++;
+        draw_revealed_glyphs();
 
-        if (g_dialogue.full_text[g_dialogue.text_index] == '\0')
+        if (g_dialogue.text_index >= g_dialogue.glyph_count)
             g_dialogue.finished = true;
-
-        g_dialogue.shown_text[g_dialogue.text_index] = '\0';
     }
 }
 
@@ -107,7 +292,8 @@ void dialogue_handle_key(SDL_Keycode key)
     {
         if (!g_dialogue.finished)
         {
-            strcpy(g_dialogue.shown_text, g_dialogue.full_text);
+            g_dialogue.text_index = g_dialogue.glyph_count;
+            draw_revealed_glyphs();
             g_dialogue.finished = true;
         }
         else
@@ -117,14 +303,22 @@ void dialogue_handle_key(SDL_Keycode key)
     }
 }
 
-// renders the dialogue
+// renders the dialogue: the portrait plus one copy of the text layer
 void dialogue_render(SDL_Renderer *renderer)
 {
     if (!g_dialogue.active)
         return;
 
-    SDL_RenderCopy(renderer, g_dialogue.texture, NULL, NULL);
-    render_text(renderer, g_dialogue.shown_text);
+    SDL_Texture *portrait = residency_acquire(g_dialogue.portrait);
+    if (portrait)
+        SDL_RenderCopy(renderer, portrait, NULL, NULL);
+
+    if (g_dialogue.text_texture && g_dialogue.text_height > 0)
+    {
+        SDL_Rect src = {0, 0, TEXT_CANVAS_W, g_dialogue.text_height};
+        SDL_Rect dst = {TEXT_X, TEXT_Y, TEXT_CANVAS_W, g_dialogue.text_height};
+        SDL_RenderCopy(renderer, g_dialogue.text_texture, &src, &dst);
+    }
 }
 
 // checks if the dialogue is active
@@ -136,8 +330,14 @@ bool dialogue_is_active(void)
 // cleans up all dialogue resources
 void dialogue_cleanup(void)
 {
-    if (g_dialogue.texture)
-        SDL_DestroyTexture(g_dialogue.texture);
+    // portraits are freed with the residency manager
+    g_dialogue.portrait = RESIDENT_NONE;
+
+    if (g_dialogue.text_texture)
+        SDL_DestroyTexture(g_dialogue.text_texture);
+
+    if (g_dialogue.text_canvas)
+        SDL_FreeSurface(g_dialogue.text_canvas);
 
     if (g_dialogue.font)
         TTF_CloseFont(g_dialogue.font);
@@ -151,13 +351,12 @@ void dialogue_cleanup(void)
 // changes the background image in the dialogue box
 void dialogue_set_portrait(const char *path)
 {
-    if (g_dialogue.texture)
-        SDL_DestroyTexture(g_dialogue.texture);
-
-    g_dialogue.texture = IMG_LoadTexture(g_dialogue.renderer, path);
+    // Switching back to a portrait shown before reuses its texture unless
+    // it was evicted in the meantime
+    g_dialogue.portrait = residency_register(path, WINDOW_WIDTH, WINDOW_HEIGHT);
 
-    if (!g_dialogue.texture)
-        printf("Portrait load error %s: %s\n", path, IMG_GetError());
+    if (g_dialogue.portrait == RESIDENT_NONE)
+        printf("Portrait load error %s\n", path);
 }
 
 TTF_Font* dialogue_get_font(void)
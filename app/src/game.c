@@ -2,48 +2,97 @@
 #include "common.h"
 #include "hal/display.h"
 #include "hal/audio.h"
+#include "hal/event_loop.h"
+#include "hal/asset_loader.h"
+#include "hal/asset_pack.h"
+#include "hal/atlas.h"
+#include "hal/image.h"
+#include "hal/residency.h"
+#include "hal/sprite.h"
 #include "player.h"
 #include "map.h"
 #include "rendering.h"
 #include "input.h"
 #include "sound_effects.h"
 #include "music.h"
+#include "prefetch.h"
 #include "dialogue.h"
 #include "catch.h"
 #include "quest.h"
+#include "text_cache.h"
+#include "profiler.h"
+#include "replay.h"
 #include <SDL2/SDL.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <math.h>
 #include <string.h>
+#include <time.h>
 #include <rendering_ui.h>
 #include <SDL2/SDL_ttf.h>
 #include <SDL2/SDL_image.h>
 
-void show_splash_screen(SDL_Renderer *renderer, const char *image_path, Uint32 duration_ms)
+// Sprite directories packed into the atlas
+static const char *const SPRITE_DIRS[] = {
+    "assets/sprites/player",
+    "assets/sprites/pets",
+    "assets/sprites/npc"};
+
+// Full-window images loaded at startup (room backgrounds in map_init,
+// portraits in dialogue_init and when talking to an NPC)
+static const char *const WINDOW_IMAGES[] = {
+    "assets/sprites/maps/asb1.png",
+    "assets/sprites/maps/classroom1.png",
+    "assets/sprites/maps/pitlab1.png",
+    "assets/dialogue/navidDialogue.png",
+    "assets/dialogue/soroushDialogue.png",
+    "assets/dialogue/mortezaDialogue.png",
+    "assets/dialogue/matthewDialogue.png"};
+
+// Time per splash frame spent uploading finished assets
+#define SPLASH_UPLOAD_BUDGET_MS 8
+
+// Frames in a row with nothing to repaint before the loop sleeps on input
+#define IDLE_FRAMES_BEFORE_SLEEP 2
+
+// Longest idle sleep, so timed logic (music start, crossfades) still runs
+#define IDLE_WAKE_MS 250
+
+// hands everything the first frame needs to the background loader
+static void queue_startup_assets(SDL_Renderer *renderer, bool audio_ready)
 {
-    // Load the splash image
-    SDL_Surface *surface = IMG_Load(image_path);
-    if (!surface)
+    for (size_t i = 0; i < sizeof(SPRITE_DIRS) / sizeof(SPRITE_DIRS[0]); i++)
+        asset_loader_queue_directory(SPRITE_DIRS[i]);
+
+    for (size_t i = 0; i < sizeof(WINDOW_IMAGES) / sizeof(WINDOW_IMAGES[0]); i++)
+        asset_loader_queue_texture(renderer, WINDOW_IMAGES[i], WINDOW_WIDTH, WINDOW_HEIGHT);
+
+    if (audio_ready)
     {
-        fprintf(stderr, "Failed to load splash screen: %s\n", IMG_GetError());
-        return;
+        asset_loader_queue_sound("assets/sounds/catch.wav", SOUND_CATCH);
+        asset_loader_queue_music(MUSIC_MAIN_HALL_PATH);
+        asset_loader_queue_music(MUSIC_ENCOUNTER_PATH);
     }
+}
 
-    SDL_Texture *texture = SDL_CreateTextureFromSurface(renderer, surface);
-    SDL_FreeSurface(surface);
-
+// shows the splash screen until the asset loader is done (or a key skips
+// it), uploading finished assets between frames
+void show_splash_screen(SDL_Renderer *renderer, const char *image_path)
+{
+    // Load the splash image at the resolution it is shown at
+    SDL_Texture *texture = image_load_texture(renderer, image_path, WINDOW_WIDTH, WINDOW_HEIGHT);
     if (!texture)
     {
-        fprintf(stderr, "Failed to create splash texture: %s\n", SDL_GetError());
+        fprintf(stderr, "Failed to load splash screen\n");
         return;
     }
 
     // Show the splash screen
-    Uint32 start_time = SDL_GetTicks();
     SDL_Event event;
     bool skip = false;
+    bool loaded = false;
 
-    while (SDL_GetTicks() - start_time < duration_ms && !skip)
+    while (!loaded && !skip)
     {
         // Allow skipping with any key
         while (SDL_PollEvent(&event))
@@ -56,6 +105,8 @@ void show_splash_screen(SDL_Renderer *renderer, const char *image_path, Uint32 d
             }
         }
 
+        loaded = asset_loader_pump(renderer, SPLASH_UPLOAD_BUDGET_MS);
+
         // Clear and render splash
         SDL_SetRenderDrawColor(renderer, 0, 0, 0, 255);
         SDL_RenderClear(renderer);
@@ -71,26 +122,158 @@ void show_splash_screen(SDL_Renderer *renderer, const char *image_path, Uint32 d
     SDL_DestroyTexture(texture);
 }
 
-void game_run(void)
+// draws the room, its entities and the UI (everything below the dialogue box)
+static void render_world(SDL_Renderer *renderer, Map *map, Room *room,
+                         PetManager *pets, Player *player)
+{
+    // background, doors and NPCs: one copy of the room's static layer
+    rendering_draw_room_static(renderer, map, room);
+
+    // every moving sprite goes out as one batched draw
+    sprite_batch_begin(renderer);
+    pet_render_all(pets, renderer,
+                   room->id,
+                   player->grid_x,
+                   player->grid_y);
+    rendering_draw_player(player);
+    sprite_batch_end();
+
+    rendering_draw_quest(renderer);
+
+    // Draw UI HUD (inventory and reset button)
+    rendering_ui_draw_hud(pets);
+}
+
+// repaints only what changed since the last frame into the display's back
+// buffer; the scene is drawn once per damaged region, clipped to it (the
+// display merges the damage into at most a few regions, see
+// display_begin_frame). Returns the number of regions repainted.
+static int render_frame(SDL_Renderer *renderer, Map *map, Room *room,
+                         PetManager *pets, Player *player, bool dialogue)
+{
+    rendering_mark_damage(room, pets, player, dialogue);
+    rendering_ui_mark_damage();
+    profiler_mark_damage();
+
+    const SDL_Rect *regions = NULL;
+    int region_count = display_begin_frame(&regions);
+
+    for (int i = 0; i < region_count; i++)
+    {
+        SDL_RenderSetClipRect(renderer, &regions[i]);
+
+        render_world(renderer, map, room, pets, player);
+        if (dialogue)
+            dialogue_render(renderer);
+        profiler_draw_overlay(renderer);
+    }
+    SDL_RenderSetClipRect(renderer, NULL);
+    profiler_mark(PROFILE_RENDER);
+
+    display_present();
+    profiler_mark(PROFILE_PRESENT);
+    return region_count;
+}
+
+// Ends a frame on the frame scheduler. After a few frames in a row that
+// repainted nothing while the player stood still, sleeps until input
+// arrives instead of waking for every deadline, with the joystick sampled
+// at its idle rate until a frame does something again.
+static void end_frame(bool idle_sleep, bool idle, int *idle_frames)
+{
+    *idle_frames = idle ? *idle_frames + 1 : 0;
+
+    bool sleeping = idle_sleep && *idle_frames >= IDLE_FRAMES_BEFORE_SLEEP;
+    input_set_idle(sleeping);
+
+    if (sleeping)
+        frame_scheduler_end_idle_frame(IDLE_WAKE_MS);
+    else
+        frame_scheduler_end_frame();
+}
+
+void game_options_defaults(GameOptions *options)
+{
+    // Animation advances per frame, so the game is tuned for a fixed rate
+    options->frame_mode = FRAME_MODE_FIXED;
+    options->target_fps = TARGET_FPS;
+    options->display_mode = DISPLAY_MODE_WINDOW;
+    options->max_frames = 0;
+    options->record_path = NULL;
+    options->replay_path = NULL;
+    options->pack_path = "assets.pak";
+    options->access_log_path = NULL;
+    options->texture_budget = RESIDENCY_DEFAULT_BUDGET;
+    options->audio_buffer_frames = 0; // adaptive
+}
+
+void game_run(const GameOptions *options)
 {
     SDL_Renderer *renderer = display_get_renderer();
 
-    show_splash_screen(renderer, "assets/sfumonTitle.png", 5000);
+    // Every asset below is opened through the pack when there is one
+    asset_pack_open(options->pack_path);
+
+    // Backgrounds and portraits load on first use and are evicted LRU
+    residency_init(renderer, options->texture_budget);
+
+    // Audio has to be open before sounds can be decoded
+    bool audio_ready = audio_init(options->audio_buffer_frames);
+    if (!audio_ready)
+        fprintf(stderr, "Warning: Failed to initialize audio\n");
+
+    // ------------------------------------------
+    // ASSET LOADING (decoded on worker threads behind the splash screen)
+    // ------------------------------------------
+    queue_startup_assets(renderer, audio_ready);
+    asset_loader_start(0);
+
+    // Nobody is watching a headless run
+    if (!display_is_headless())
+        show_splash_screen(renderer, "assets/sfumonTitle.png");
+    asset_loader_finish(renderer);
 
     dialogue_init(renderer);
 
     if (!input_initialize())
         fprintf(stderr, "Warning: Failed to initialize input\n");
-    if (!audio_init())
-        fprintf(stderr, "Warning: Failed to initialize audio\n");
 
-    audio_load_sound("assets/sounds/catch.wav", SOUND_CATCH);
+    if (!event_loop_init())
+        fprintf(stderr, "Warning: Failed to create event loop, never sleeping on input\n");
 
     if (TTF_Init() == -1)
     {
         fprintf(stderr, "Warning: Failed to initialize SDL_ttf: %s\n", TTF_GetError());
     }
 
+    if (!text_cache_init(renderer, TEXT_CACHE_DEFAULT_BUDGET))
+        fprintf(stderr, "Warning: Failed to initialize text cache\n");
+
+    // ------------------------------------------
+    // SPRITE ATLAS (must exist before any sprite_load)
+    // ------------------------------------------
+    if (!atlas_init(renderer, SPRITE_DIRS, sizeof(SPRITE_DIRS) / sizeof(SPRITE_DIRS[0])))
+        fprintf(stderr, "Warning: Failed to build sprite atlas\n");
+
+    // Damage is tracked per tile
+    display_set_damage_cell(TILE_SIZE);
+
+    // ------------------------------------------
+    // RECORD / REPLAY (before anything calls rand())
+    // ------------------------------------------
+    unsigned int seed = (unsigned int)time(NULL);
+    if (options->replay_path)
+    {
+        if (!replay_play_open(options->replay_path, &seed))
+            fprintf(stderr, "Warning: Failed to open replay, playing live\n");
+    }
+    else if (options->record_path)
+    {
+        if (!replay_record_open(options->record_path, seed))
+            fprintf(stderr, "Warning: Failed to start recording\n");
+    }
+    srand(seed);
+
     // ------------------------------------------
     // MAP + PLAYER INITIALIZATION
     // ------------------------------------------
@@ -114,65 +297,138 @@ void game_run(void)
     if (!music_init())
         fprintf(stderr, "Warning: Music initialization failed\n");
 
+    // Warms the next room while the player walks up to its door
+    if (!prefetch_init(renderer, audio_ready))
+        fprintf(stderr, "Warning: Failed to start room prefetching\n");
+
+    // Only vsync mode waits on the display; the others pace themselves
+    display_set_vsync(options->frame_mode == FRAME_MODE_VSYNC);
+    frame_scheduler_init(options->frame_mode, options->target_fps,
+                         display_get_refresh_rate());
+
+    profiler_init();
+
+    // Sleeping on input needs a descriptor for every input source. SDL has
+    // none of its own, so keyboard and mouse wake us through our own copy
+    // of the input devices. A replay or headless run never waits.
+    bool idle_sleep = false;
+    if (!options->replay_path && !display_is_headless())
+    {
+        bool devices = event_loop_watch_input_devices() > 0;
+        bool hardware = input_register_wakeups();
+        idle_sleep = devices || hardware;
+    }
+    int idle_frames = 0;
+
     Uint32 last_move_time = 0;
-    bool space_was_pressed = false;
-    bool interact_was_pressed = false;
-    bool reset_was_pressed = false;
+    InputStamp pending_move = {0}; // direction change the player has not acted on yet
     bool running = true;
+    int frame_count = 0;
     SDL_Event event;
 
     // ==========================================
     // MAIN GAME LOOP
     // ==========================================
+    Uint64 loop_start = SDL_GetPerformanceCounter();
+
     while (running)
     {
-        Uint32 current_time = SDL_GetTicks();
+        if (options->max_frames > 0 && frame_count >= options->max_frames)
+            break;
+        frame_count++;
 
-        if (!music_has_started && current_time > 5000)
-        {
-            music_start_delayed();
-            music_has_started = true;
-        }
+        profiler_begin_frame();
+        residency_begin_frame();
+
+        FrameInput frame = {0};
 
         // ------------------------------------------
         // EVENT POLLING (SDL events only)
         // ------------------------------------------
         while (SDL_PollEvent(&event))
         {
+            // A replay brings its own input
+            if (!replay_is_playing())
+                input_handle_event(&event);
+
             if (event.type == SDL_QUIT)
                 running = false;
 
             if (event.type == SDL_KEYDOWN && event.key.keysym.sym == SDLK_ESCAPE)
                 running = false;
 
-            if (event.type == SDL_MOUSEBUTTONDOWN)
+            if (event.type == SDL_KEYDOWN && event.key.keysym.sym == SDLK_F3)
+                profiler_toggle_overlay();
+
+            // Render-target contents are lost on a device/target reset
+            if (event.type == SDL_RENDER_TARGETS_RESET || event.type == SDL_RENDER_DEVICE_RESET)
             {
-                if (event.button.button == SDL_BUTTON_LEFT)
-                {
-                    int mouse_x = event.button.x;
-                    int mouse_y = event.button.y;
+                rendering_ui_mark_dirty();
+                map_invalidate_static_layers(&game_map);
+                display_damage_all();
+            }
 
-                    if (rendering_ui_check_reset_click(mouse_x, mouse_y))
-                    {
-                        rendering_ui_reset_catches(&pets);
-                    }
-                }
+            // first left click of the frame (reset button on host)
+            if (event.type == SDL_MOUSEBUTTONDOWN &&
+                event.button.button == SDL_BUTTON_LEFT && !frame.clicked)
+            {
+                frame.clicked = true;
+                frame.click_x = event.button.x;
+                frame.click_y = event.button.y;
             }
         }
         // END OF EVENT POLLING
+        profiler_mark(PROFILE_EVENTS);
+
+        // ------------------------------------------
+        // FRAME INPUT (devices, or the recording when replaying)
+        // ------------------------------------------
+        if (replay_is_playing())
+        {
+            if (!replay_next_frame(&frame))
+            {
+                printf("Replay: Finished\n");
+                break;
+            }
+        }
+        else
+        {
+            // One snapshot of every device per frame
+            InputSnapshot snapshot;
+            input_capture(&snapshot);
+
+            frame.time_ms = SDL_GetTicks();
+            input_read_frame(&snapshot, &frame);
 
-        // Poll input state
-        input_poll_once_per_frame();
+            replay_record_frame(&frame);
+        }
+        profiler_mark(PROFILE_INPUT);
+
+        Uint32 current_time = frame.time_ms;
+
+        if (!music_has_started && current_time > 5000)
+        {
+            music_start_delayed();
+            music_has_started = true;
+        }
+
+        if (frame.clicked && rendering_ui_check_reset_click(frame.click_x, frame.click_y))
+        {
+            rendering_ui_reset_catches(&pets);
+            display_mark_input(frame.reset_stamp.id, frame.reset_stamp.time_ns);
+        }
 
         Room *current_room = map_get_current_room(&game_map);
 
         if (music_has_started)
             music_update(current_room, player.grid_x, player.grid_y);
+        profiler_mark(PROFILE_MUSIC);
 
         // ------------------------------------------
         // DIALOGUE HANDLING (T key on host, button on target)
         // ------------------------------------------
-        if (input_is_interact_pressed(&interact_was_pressed))
+        bool dialogue_was_active = dialogue_is_active();
+        if (frame.interact_pressed)
         {
             // If dialogue is active, close it
             if (dialogue_is_active())
@@ -346,45 +602,39 @@ void game_run(void)
             }
         }
 
+        // Opening or closing the dialogue is what the press shows
+        if (dialogue_is_active() != dialogue_was_active)
+            display_mark_input(frame.interact_stamp.id, frame.interact_stamp.time_ns);
+
         // ------------------------------------------
         // DIALOGUE FREEZE MODE
         // ------------------------------------------
         if (dialogue_is_active())
         {
-            dialogue_update_typewriter();
+            dialogue_update_typewriter(current_time);
+            profiler_mark(PROFILE_UPDATE);
 
-            display_clear(0, 0, 0);
-            map_render_background(&game_map, renderer);
-
-            rendering_draw_doors(current_room->doors, current_room->door_count);
-            pet_render_all(&pets, renderer,
-                           current_room->id,
-                           player.grid_x,
-                           player.grid_y);
-            rendering_draw_npcs(current_room->npcs, current_room->npc_count);
-            rendering_draw_player(&player);
-            rendering_draw_quest(renderer);
-
-            rendering_ui_draw_hud(&pets);
-            dialogue_render(renderer);
-            display_present();
-            SDL_Delay(FRAME_DELAY);
+            int regions = render_frame(renderer, &game_map, current_room, &pets, &player, true);
+            text_cache_end_frame();
+            end_frame(idle_sleep, regions == 0, &idle_frames);
+            profiler_mark(PROFILE_WAIT);
             continue;
         }
 
         // ------------------------------------------
         // RESET BUTTON CHECK (hardware button on target)
         // ------------------------------------------
-        if (input_is_reset_pressed(&reset_was_pressed))
+        if (frame.reset_pressed)
         {
             printf("Reset button pressed!\n");
             rendering_ui_reset_catches(&pets);
+            display_mark_input(frame.reset_stamp.id, frame.reset_stamp.time_ns);
         }
 
         // ------------------------------------------
         // PET CATCHING (SPACE on host, button on target)
         // ------------------------------------------
-        if (input_is_catch_pressed(&space_was_pressed))
+        if (frame.catch_pressed)
         {
             Pet *p = pet_check_adjacent(&pets,
                                         player.grid_x,
@@ -397,14 +647,25 @@ void game_run(void)
                 rendering_ui_increment_catch(p->type);
                 pet_catch(&pets, p);
                 pet_check_respawn(&pets, renderer, &game_map);
+                display_mark_input(frame.catch_stamp.id, frame.catch_stamp.time_ns);
             }
         }
 
         // ------------------------------------------
         // PLAYER MOVEMENT
         // ------------------------------------------
-        InputDirection dir = input_get_direction();
-        player_handle_movement(&player, dir,
+        // A new direction counts once the player turns or starts moving,
+        // which can be a few frames later while a step is in progress;
+        // letting go of the stick shows nothing
+        if (frame.direction_stamp.id != 0)
+            pending_move = frame.direction_stamp;
+        if (frame.direction == INPUT_NONE)
+            pending_move.id = 0;
+
+        bool was_moving = player.is_moving;
+        Direction was_facing = player.current_direction;
+
+        player_handle_movement(&player, frame.direction,
                                current_room->obstacles,
                                current_room->npcs,
                                current_room->npc_count,
@@ -413,11 +674,21 @@ void game_run(void)
                                &pets,
                                current_room->id);
 
+        if (pending_move.id != 0 &&
+            ((player.is_moving && !was_moving) || player.current_direction != was_facing))
+        {
+            display_mark_input(pending_move.id, pending_move.time_ns);
+            pending_move.id = 0;
+        }
+
         player_update_animation(&player);
 
         // ------------------------------------------
         // ROOM TRANSITION
         // ------------------------------------------
+        // Start loading the rooms behind nearby doors
+        prefetch_update(&game_map, player_get_grid_x(&player), player_get_grid_y(&player));
+
         if (!player.is_moving && !player.just_teleported)
         {
             Door *door = map_check_door_collision(&game_map,
@@ -444,6 +715,7 @@ void game_run(void)
                 player.just_teleported = true;
 
                 current_room = map_get_current_room(&game_map);
+                prefetch_room_entered(current_room);
                 music_change_room(current_room->music_path);
             }
         }
@@ -465,39 +737,50 @@ void game_run(void)
         // ------------------------------------------
         // NORMAL FRAME RENDERING
         // ------------------------------------------
-        display_clear(0, 0, 0);
+        profiler_mark(PROFILE_UPDATE);
 
-        map_render_background(&game_map, renderer);
-
-        rendering_draw_doors(current_room->doors, current_room->door_count);
-        pet_render_all(&pets, renderer,
-                       current_room->id,
-                       player.grid_x,
-                       player.grid_y);
-        rendering_draw_npcs(current_room->npcs, current_room->npc_count);
-        rendering_draw_player(&player);
-        rendering_draw_quest(renderer);
-
-        // Draw UI HUD (inventory and reset button)
-        rendering_ui_draw_hud(&pets);
-
-        display_present();
-        SDL_Delay(FRAME_DELAY);
+        int regions = render_frame(renderer, &game_map, current_room, &pets, &player, false);
+        text_cache_end_frame();
+        end_frame(idle_sleep,
+                  regions == 0 && frame.direction == INPUT_NONE && !player.is_moving,
+                  &idle_frames);
+        profiler_mark(PROFILE_WAIT);
 
     } // END OF WHILE (running)
 
     // ------------------------------------------
     // CLEANUP
     // ------------------------------------------
+    if (replay_is_playing())
+    {
+        double seconds = (double)(SDL_GetPerformanceCounter() - loop_start) /
+                         (double)SDL_GetPerformanceFrequency();
+        printf("Replay: %d frames in %.2f s (%.1f fps)\n",
+               frame_count, seconds, seconds > 0.0 ? frame_count / seconds : 0.0);
+    }
+    replay_close();
+
     pet_manager_cleanup(&pets);
+    text_cache_cleanup(); // before the fonts it is keyed on are closed
     rendering_ui_cleanup();
     TTF_Quit();
     dialogue_cleanup();
     input_cleanup();
+    prefetch_cleanup(); // before the audio and residency it feeds
     music_cleanup();
     audio_cleanup();
     map_cleanup(&game_map);
+    residency_cleanup(); // backgrounds and portraits
     player_cleanup(&player);
+    atlas_cleanup();
+    image_preload_clear(); // portraits nobody talked to
+    frame_scheduler_cleanup();
+    event_loop_cleanup();
+    profiler_cleanup();
+
+    if (options->access_log_path)
+        asset_pack_write_access_order(options->access_log_path);
+    asset_pack_close(); // after the music and fonts streaming from it
 
     printf("\n=== Game Over! ===\n");
 }
\ No newline at end of file
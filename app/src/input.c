@@ -1,9 +1,50 @@
+#define _POSIX_C_SOURCE 200809L
 #include "input.h"
+#include "hal/event_loop.h"
 #include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#define INPUT_BIT(button) (1u << (button))
+
+// Keyboard keys and the input each one drives
+typedef struct
+{
+    SDL_Scancode scancode;
+    InputButton button;
+} KeyBinding;
+
+static const KeyBinding KEY_BINDINGS[] = {
+    {SDL_SCANCODE_UP, INPUT_BUTTON_UP},
+    {SDL_SCANCODE_W, INPUT_BUTTON_UP},
+    {SDL_SCANCODE_DOWN, INPUT_BUTTON_DOWN},
+    {SDL_SCANCODE_S, INPUT_BUTTON_DOWN},
+    {SDL_SCANCODE_LEFT, INPUT_BUTTON_LEFT},
+    {SDL_SCANCODE_A, INPUT_BUTTON_LEFT},
+    {SDL_SCANCODE_RIGHT, INPUT_BUTTON_RIGHT},
+    {SDL_SCANCODE_D, INPUT_BUTTON_RIGHT},
+    {SDL_SCANCODE_SPACE, INPUT_BUTTON_CATCH},
+    {SDL_SCANCODE_T, INPUT_BUTTON_INTERACT}};
+
+#define KEY_BINDING_COUNT (int)(sizeof(KEY_BINDINGS) / sizeof(KEY_BINDINGS[0]))
 
 static bool use_joystick = false;
 static bool use_button = false;
-static bool cached_button_just_pressed = false;
+static bool joystick_slowed = false;
+
+// Every input gets the next id, for latency measurement
+static unsigned long next_input_id = 1;
+
+// Held state per source
+static bool key_down[KEY_BINDING_COUNT];
+static joystickDirection joystick_direction = joy_rest;
+static bool button_down[BUTTON_COUNT];
+
+// Key events SDL delivered since the last capture, in order
+static InputEvent key_events[INPUT_MAX_EVENTS];
+static int key_event_count = 0;
+static InputStamp pending_click;
+static unsigned long events_dropped = 0;
 
 // Detect if we're on target device by checking for SPI
 static bool is_target_device(void)
@@ -19,12 +60,20 @@ static bool is_target_device(void)
 
 bool input_initialize(void)
 {
+    memset(key_down, 0, sizeof(key_down));
+    memset(button_down, 0, sizeof(button_down));
+    joystick_direction = joy_rest;
+    key_event_count = 0;
+    pending_click.id = 0;
+    events_dropped = 0;
+    joystick_slowed = false;
+
     // Try to detect target and initialize joystick
     if (is_target_device())
     {
         printf("Target device detected - attempting hardware initialization...\n");
 
-        if (joystick_initialize())
+        if (joystick_initialize(0))
         {
             use_joystick = true;
             printf("✓ Using joystick input\n");
@@ -50,124 +99,286 @@ bool input_initialize(void)
     return true;
 }
 
-void input_poll_once_per_frame(void)
+bool input_register_wakeups(void)
 {
+    bool registered = false;
+
+    // The joystick counter is only a wakeup, nobody else reads it
+    if (use_joystick)
+        registered |= event_loop_watch_fd(joystick_get_fd(), true);
+
+    // Button edges stay queued for button_update to debounce
     if (use_button)
-        cached_button_just_pressed = button_wasJustPressed();
-    else
-        cached_button_just_pressed = false;
+    {
+        registered |= event_loop_watch_fd(button_get_fd(BUTTON_CATCH), false);
+        registered |= event_loop_watch_fd(button_get_fd(BUTTON_RESET), false);
+    }
+
+    return registered;
 }
 
-bool input_button_just_pressed_cached(void)
+void input_set_idle(bool idle)
 {
-    return cached_button_just_pressed;
+    if (!use_joystick)
+        return;
+
+    // A held direction keeps the full rate, so its release is seen promptly
+    bool slow = idle && joystick_direction == joy_rest;
+    if (slow == joystick_slowed)
+        return;
+
+    joystick_set_rate(slow ? JOYSTICK_IDLE_RATE_HZ : 0);
+    joystick_slowed = slow;
 }
 
-InputDirection input_get_direction(void)
+static InputStamp next_stamp(uint64_t time_ns)
 {
-    if (use_joystick)
+    InputStamp stamp;
+    stamp.id = next_input_id++;
+    stamp.time_ns = time_ns;
+    return stamp;
+}
+
+// SDL event times are SDL_GetTicks milliseconds; both run on the monotonic
+// clock, so the offset from now carries over
+static uint64_t event_time_ns(Uint32 event_ticks)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    uint64_t now_ns = (uint64_t)now.tv_sec * 1000000000ull + (uint64_t)now.tv_nsec;
+    uint64_t age_ns = (uint64_t)(SDL_GetTicks() - event_ticks) * 1000000ull;
+    return age_ns < now_ns ? now_ns - age_ns : now_ns;
+}
+
+static void append_event(InputEvent *events, int *count, InputButton button,
+                         bool pressed, InputStamp stamp)
+{
+    if (*count >= INPUT_MAX_EVENTS)
     {
-        // Read joystick
-        joystickDirection joy_dir = joystick_getDirection();
+        events_dropped++;
+        return;
+    }
 
-        switch (joy_dir)
-        {
-        case joy_up:
-            return INPUT_UP;
-        case joy_down:
-            return INPUT_DOWN;
-        case joy_left:
-            return INPUT_LEFT;
-        case joy_right:
-            return INPUT_RIGHT;
-        case joy_rest:
-        default:
-            return INPUT_NONE;
-        }
+    events[*count].button = button;
+    events[*count].pressed = pressed;
+    events[*count].stamp = stamp;
+    (*count)++;
+}
+
+void input_handle_event(const SDL_Event *event)
+{
+    if (event->type == SDL_MOUSEBUTTONDOWN && event->button.button == SDL_BUTTON_LEFT)
+    {
+        if (pending_click.id == 0)
+            pending_click = next_stamp(event_time_ns(event->button.timestamp));
+        return;
     }
-    else
+
+    if ((event->type != SDL_KEYDOWN && event->type != SDL_KEYUP) || event->key.repeat)
+        return;
+
+    bool pressed = event->type == SDL_KEYDOWN;
+    for (int i = 0; i < KEY_BINDING_COUNT; i++)
     {
-        // Read keyboard
-        const Uint8 *keys = SDL_GetKeyboardState(NULL);
+        if (KEY_BINDINGS[i].scancode != event->key.keysym.scancode || key_down[i] == pressed)
+            continue;
 
-        if (keys[SDL_SCANCODE_UP] || keys[SDL_SCANCODE_W])
-        {
-            return INPUT_UP;
-        }
-        if (keys[SDL_SCANCODE_DOWN] || keys[SDL_SCANCODE_S])
-        {
-            return INPUT_DOWN;
-        }
-        if (keys[SDL_SCANCODE_LEFT] || keys[SDL_SCANCODE_A])
-        {
-            return INPUT_LEFT;
-        }
-        if (keys[SDL_SCANCODE_RIGHT] || keys[SDL_SCANCODE_D])
+        key_down[i] = pressed;
+        append_event(key_events, &key_event_count, KEY_BINDINGS[i].button, pressed,
+                     next_stamp(event_time_ns(event->key.timestamp)));
+    }
+}
+
+static InputButton joystick_button(joystickDirection direction)
+{
+    switch (direction)
+    {
+    case joy_up:
+        return INPUT_BUTTON_UP;
+    case joy_down:
+        return INPUT_BUTTON_DOWN;
+    case joy_left:
+        return INPUT_BUTTON_LEFT;
+    case joy_right:
+        return INPUT_BUTTON_RIGHT;
+    case joy_rest:
+        break;
+    }
+    return INPUT_BUTTON_COUNT;
+}
+
+// Sources are read one after the other; merge them into time order
+// (insertion sort, stable for events with the same time)
+static void sort_events(InputSnapshot *snapshot)
+{
+    for (int i = 1; i < snapshot->event_count; i++)
+    {
+        InputEvent event = snapshot->events[i];
+        int j = i - 1;
+        while (j >= 0 && snapshot->events[j].stamp.time_ns > event.stamp.time_ns)
         {
-            return INPUT_RIGHT;
+            snapshot->events[j + 1] = snapshot->events[j];
+            j--;
         }
-
-        return INPUT_NONE;
+        snapshot->events[j + 1] = event;
     }
 }
 
-bool input_is_catch_pressed(bool *last_state)
+void input_capture(InputSnapshot *snapshot)
 {
-    if (use_button)
+    snapshot->event_count = 0;
+
+    for (int i = 0; i < key_event_count; i++)
     {
-        // Use hardware button
-        return input_button_just_pressed_cached();
+        append_event(snapshot->events, &snapshot->event_count, key_events[i].button,
+                     key_events[i].pressed, key_events[i].stamp);
     }
-    else
+    key_event_count = 0;
+
+    snapshot->click_stamp = pending_click;
+    pending_click.id = 0;
+
+    // Every debounced edge, including presses shorter than a frame
+    for (int id = 0; use_button && id < BUTTON_COUNT; id++)
     {
-        // Use keyboard spacebar with edge detection
-        const Uint8 *keys = SDL_GetKeyboardState(NULL);
-        bool current_state = keys[SDL_SCANCODE_SPACE];
+        bool pressed;
+        uint64_t time_ns;
+        while (button_take_edge((ButtonId)id, &pressed, &time_ns))
+        {
+            button_down[id] = pressed;
+            InputStamp stamp = next_stamp(time_ns);
 
-        bool just_pressed = (current_state && !(*last_state));
-        *last_state = current_state;
+            if (id == BUTTON_CATCH)
+            {
+                // The one button both catches and talks
+                append_event(snapshot->events, &snapshot->event_count, INPUT_BUTTON_CATCH, pressed, stamp);
+                append_event(snapshot->events, &snapshot->event_count, INPUT_BUTTON_INTERACT, pressed, stamp);
+            }
+            else
+            {
+                append_event(snapshot->events, &snapshot->event_count, INPUT_BUTTON_RESET, pressed, stamp);
+            }
+        }
+    }
 
-        return just_pressed;
+    // Every change of the filtered direction, timed by its SPI read
+    JoystickChange change;
+    while (use_joystick && joystick_take_change(&change))
+    {
+        InputStamp stamp = next_stamp(change.timestamp_ns);
+        if (joystick_direction != joy_rest)
+            append_event(snapshot->events, &snapshot->event_count,
+                         joystick_button(joystick_direction), false, stamp);
+        if (change.direction != joy_rest)
+            append_event(snapshot->events, &snapshot->event_count,
+                         joystick_button(change.direction), true, stamp);
+        joystick_direction = change.direction;
     }
+
+    sort_events(snapshot);
+
+    snapshot->held = 0;
+    for (int i = 0; i < KEY_BINDING_COUNT; i++)
+    {
+        if (key_down[i])
+            snapshot->held |= INPUT_BIT(KEY_BINDINGS[i].button);
+    }
+    if (joystick_direction != joy_rest)
+        snapshot->held |= INPUT_BIT(joystick_button(joystick_direction));
+    if (button_down[BUTTON_CATCH])
+        snapshot->held |= INPUT_BIT(INPUT_BUTTON_CATCH) | INPUT_BIT(INPUT_BUTTON_INTERACT);
+    if (button_down[BUTTON_RESET])
+        snapshot->held |= INPUT_BIT(INPUT_BUTTON_RESET);
 }
 
-bool input_is_interact_pressed(bool *last_state)
+bool input_is_held(const InputSnapshot *snapshot, InputButton button)
 {
-    if (use_button)
+    return (snapshot->held & INPUT_BIT(button)) != 0;
+}
+
+const InputEvent *input_first_press(const InputSnapshot *snapshot, InputButton button)
+{
+    for (int i = 0; i < snapshot->event_count; i++)
     {
-        // Use same hardware button
-        return input_button_just_pressed_cached();
+        const InputEvent *event = &snapshot->events[i];
+        if (event->button == button && event->pressed)
+            return event;
     }
-    else
+    return NULL;
+}
+
+static InputDirection button_direction(InputButton button)
+{
+    switch (button)
     {
-        // Use keyboard 'T' key with edge detection
-        const Uint8 *keys = SDL_GetKeyboardState(NULL);
-        bool current_state = keys[SDL_SCANCODE_T];
-        bool just_pressed = (current_state && !(*last_state));
-        *last_state = current_state;
-        return just_pressed;
+    case INPUT_BUTTON_UP:
+        return INPUT_UP;
+    case INPUT_BUTTON_DOWN:
+        return INPUT_DOWN;
+    case INPUT_BUTTON_LEFT:
+        return INPUT_LEFT;
+    case INPUT_BUTTON_RIGHT:
+        return INPUT_RIGHT;
+    default:
+        return INPUT_NONE;
     }
 }
 
-bool input_is_reset_pressed(bool *last_state)
+// last direction pressed in the snapshot (NULL when none)
+static const InputEvent *last_direction_press(const InputSnapshot *snapshot)
 {
-    (void)last_state;
-
-    if (use_button)
+    for (int i = snapshot->event_count - 1; i >= 0; i--)
     {
-        // Use hardware reset button
-        return button_reset_wasJustPressed();
+        const InputEvent *event = &snapshot->events[i];
+        if (event->pressed && button_direction(event->button) != INPUT_NONE)
+            return event;
     }
-    else
+    return NULL;
+}
+
+InputDirection input_snapshot_direction(const InputSnapshot *snapshot)
+{
+    for (int b = INPUT_BUTTON_UP; b <= INPUT_BUTTON_RIGHT; b++)
     {
-        // On host, this is handled by mouse click, so always return false
-        // (Mouse clicks are handled in the event loop)
-        return false;
+        if (input_is_held(snapshot, (InputButton)b))
+            return button_direction((InputButton)b);
     }
+
+    // A tap that was released again before the frame still takes a step
+    const InputEvent *tap = last_direction_press(snapshot);
+    return tap ? button_direction(tap->button) : INPUT_NONE;
+}
+
+void input_read_frame(const InputSnapshot *snapshot, FrameInput *frame)
+{
+    frame->direction = input_snapshot_direction(snapshot);
+
+    const InputEvent *direction = last_direction_press(snapshot);
+    if (direction)
+        frame->direction_stamp = direction->stamp;
+
+    const InputEvent *press = input_first_press(snapshot, INPUT_BUTTON_CATCH);
+    frame->catch_pressed = press != NULL;
+    if (press)
+        frame->catch_stamp = press->stamp;
+
+    press = input_first_press(snapshot, INPUT_BUTTON_INTERACT);
+    frame->interact_pressed = press != NULL;
+    if (press)
+        frame->interact_stamp = press->stamp;
+
+    // Reset is a hardware button on target and a click on the HUD on host
+    press = input_first_press(snapshot, INPUT_BUTTON_RESET);
+    frame->reset_pressed = press != NULL;
+    frame->reset_stamp = press ? press->stamp : snapshot->click_stamp;
 }
 
 void input_cleanup(void)
 {
+    if (events_dropped > 0)
+        printf("Input: %lu events dropped (more than %d in a frame)\n",
+               events_dropped, INPUT_MAX_EVENTS);
+
     if (use_joystick)
     {
         joystick_cleanup();
@@ -178,4 +389,4 @@ void input_cleanup(void)
     {
         button_cleanup();
     }
-}
\ No newline at end of file
+}
@@ -1,15 +1,139 @@
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 #include "hal/display.h"
 #include "common.h"
 #include "game.h"
 
+static void print_usage(const char *program)
+{
+    printf("Usage: %s [--frame-mode=vsync|fixed|uncapped] [--fps=N]\n"
+           "          [--headless[=software|null]] [--frames=N]\n"
+           "          [--record=FILE | --replay=FILE]\n"
+           "          [--pack=FILE] [--access-log=FILE] [--texture-budget=MB]\n"
+           "          [--audio-buffer=FRAMES (default: adaptive)]\n", program);
+}
+
+// parses command line options, returns false on a bad option
+static bool parse_options(int argc, char *argv[], GameOptions *options)
+{
+    bool frame_mode_given = false;
+
+    for (int i = 1; i < argc; i++)
+    {
+        const char *arg = argv[i];
+
+        if (strncmp(arg, "--frame-mode=", 13) == 0)
+        {
+            if (!frame_scheduler_parse_mode(arg + 13, &options->frame_mode))
+            {
+                fprintf(stderr, "Unknown frame mode '%s'\n", arg + 13);
+                return false;
+            }
+            frame_mode_given = true;
+        }
+        else if (strncmp(arg, "--fps=", 6) == 0)
+        {
+            options->target_fps = atoi(arg + 6);
+            if (options->target_fps <= 0)
+            {
+                fprintf(stderr, "Invalid frame rate '%s'\n", arg + 6);
+                return false;
+            }
+        }
+        else if (strcmp(arg, "--headless") == 0 || strcmp(arg, "--headless=software") == 0)
+        {
+            options->display_mode = DISPLAY_MODE_HEADLESS_SOFTWARE;
+        }
+        else if (strcmp(arg, "--headless=null") == 0)
+        {
+            options->display_mode = DISPLAY_MODE_HEADLESS_NULL;
+        }
+        else if (strncmp(arg, "--frames=", 9) == 0)
+        {
+            options->max_frames = atoi(arg + 9);
+            if (options->max_frames <= 0)
+            {
+                fprintf(stderr, "Invalid frame count '%s'\n", arg + 9);
+                return false;
+            }
+        }
+        else if (strncmp(arg, "--record=", 9) == 0 && arg[9] != '\0')
+        {
+            options->record_path = arg + 9;
+        }
+        else if (strncmp(arg, "--replay=", 9) == 0 && arg[9] != '\0')
+        {
+            options->replay_path = arg + 9;
+        }
+        else if (strncmp(arg, "--pack=", 7) == 0 && arg[7] != '\0')
+        {
+            options->pack_path = arg + 7;
+        }
+        else if (strncmp(arg, "--access-log=", 13) == 0 && arg[13] != '\0')
+        {
+            options->access_log_path = arg + 13;
+        }
+        else if (strncmp(arg, "--texture-budget=", 17) == 0)
+        {
+            int megabytes = atoi(arg + 17);
+            if (megabytes <= 0)
+            {
+                fprintf(stderr, "Invalid texture budget '%s'\n", arg + 17);
+                return false;
+            }
+            options->texture_budget = (size_t)megabytes * 1024u * 1024u;
+        }
+        else if (strncmp(arg, "--audio-buffer=", 15) == 0)
+        {
+            int frames = atoi(arg + 15);
+            if (frames < 64 || frames > 8192 || (frames & (frames - 1)) != 0)
+            {
+                fprintf(stderr, "Invalid audio buffer '%s' (a power of two, 64-8192)\n", arg + 15);
+                return false;
+            }
+            options->audio_buffer_frames = frames;
+        }
+        else
+        {
+            fprintf(stderr, "Unknown option '%s'\n", arg);
+            return false;
+        }
+    }
+
+    if (options->record_path && options->replay_path)
+    {
+        fprintf(stderr, "--record and --replay cannot be combined\n");
+        return false;
+    }
+
+    // Headless runs and replays are benchmarks: run at full speed unless
+    // told otherwise (replays take their time from the recording)
+    if ((options->display_mode != DISPLAY_MODE_WINDOW || options->replay_path) &&
+        !frame_mode_given)
+        options->frame_mode = FRAME_MODE_UNCAPPED;
+
+    return true;
+}
+
 int main(int argc, char *argv[])
 {
-    (void)argc;
-    (void)argv;
+    GameOptions options;
+    game_options_defaults(&options);
+
+    if (!parse_options(argc, argv, &options))
+    {
+        print_usage(argv[0]);
+        return 1;
+    }
+
+    // Build servers have no sound card either
+    if (options.display_mode != DISPLAY_MODE_WINDOW)
+        SDL_setenv("SDL_AUDIODRIVER", "dummy", 0);
 
     // Initialize display
-    if (!display_init("SFUmon - Smooth Movement", WINDOW_WIDTH, WINDOW_HEIGHT))
+    if (!display_init_mode("SFUmon - Smooth Movement", WINDOW_WIDTH, WINDOW_HEIGHT,
+                           options.display_mode))
     {
         fprintf(stderr, "Failed to initialize display\n");
         return 1;
@@ -23,7 +147,7 @@ int main(int argc, char *argv[])
     printf("Press ESC to quit.\n\n");
 
     // Run the game
-    game_run();
+    game_run(&options);
 
     // Cleanup
     display_cleanup();
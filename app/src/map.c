@@ -5,25 +5,17 @@
 #include <SDL2/SDL_image.h>
 
 // ----------------------------------------------------
-// Load background PNG
+// Register a background PNG with the residency manager;
+// it is loaded (pre-scaled to the pixels the full-window
+// background covers on the output) on first draw
 // ----------------------------------------------------
-static SDL_Texture *load_room_texture(SDL_Renderer *renderer, const char *path)
+static ResidentTexture load_room_texture(const char *path)
 {
-    SDL_Surface *surface = IMG_Load(path);
-    if (!surface)
-    {
-        fprintf(stderr, "Failed to load image %s: %s\n", path, IMG_GetError());
-        return NULL;
-    }
-
-    SDL_Texture *texture = SDL_CreateTextureFromSurface(renderer, surface);
-    SDL_FreeSurface(surface);
+    ResidentTexture background = residency_register(path, WINDOW_WIDTH, WINDOW_HEIGHT);
+    if (background == RESIDENT_NONE)
+        fprintf(stderr, "Failed to register background: %s\n", path);
 
-    if (!texture)
-        fprintf(stderr, "Failed to create texture from %s: %s\n", path, SDL_GetError());
-
-    printf("Loaded background: %s\n", path);
-    return texture;
+    return background;
 }
 
 // ----------------------------------------------------
@@ -193,6 +185,12 @@ void map_init(Map *map, SDL_Renderer *renderer)
 
     map->current_room_id = ROOM_ASB;
 
+    for (int r = 0; r < ROOM_COUNT; r++)
+    {
+        map->rooms[r].static_layer = NULL;
+        map->rooms[r].static_dirty = true;
+    }
+
     // ==============================
     // ASB
     // ==============================
@@ -200,7 +198,7 @@ void map_init(Map *map, SDL_Renderer *renderer)
     asb->id = ROOM_ASB;
     strcpy(asb->name, "ASB");
     strcpy(asb->music_path, "assets/music/main_hall.ogg");
-    asb->background_texture = load_room_texture(renderer, "assets/sprites/maps/asb1.png");
+    asb->background = load_room_texture("assets/sprites/maps/asb1.png");
     init_room_obstacles(asb->obstacles, ROOM_ASB);
 
     asb->door_count = 2;
@@ -231,7 +229,7 @@ void map_init(Map *map, SDL_Renderer *renderer)
     classroom->id = ROOM_CLASSROOM;
     strcpy(classroom->name, "Classroom");
     strcpy(classroom->music_path, "assets/music/classroom.ogg");
-    classroom->background_texture = load_room_texture(renderer, "assets/sprites/maps/classroom1.png");
+    classroom->background = load_room_texture("assets/sprites/maps/classroom1.png");
     init_room_obstacles(classroom->obstacles, ROOM_CLASSROOM);
 
     classroom->door_count = 1;
@@ -254,7 +252,7 @@ void map_init(Map *map, SDL_Renderer *renderer)
     pitlab->id = ROOM_PITLAB;
     strcpy(pitlab->name, "PIT Lab");
     strcpy(pitlab->music_path, "assets/music/basement.ogg");
-    pitlab->background_texture = load_room_texture(renderer, "assets/sprites/maps/pitlab1.png");
+    pitlab->background = load_room_texture("assets/sprites/maps/pitlab1.png");
     init_room_obstacles(pitlab->obstacles, ROOM_PITLAB);
 
     pitlab->door_count = 1;
@@ -290,12 +288,41 @@ Door *map_check_door_collision(Map *map, int px, int py)
     return NULL;
 }
 
+// ----------------------------------------------------
+static void release_static_layer(Room *room)
+{
+    if (room->static_layer)
+    {
+        residency_untrack(room->static_layer);
+        SDL_DestroyTexture(room->static_layer);
+        room->static_layer = NULL;
+    }
+    room->static_dirty = true;
+}
+
+void map_mark_static_dirty(Room *room)
+{
+    if (room)
+        room->static_dirty = true;
+}
+
+void map_invalidate_static_layers(Map *map)
+{
+    for (int r = 0; r < ROOM_COUNT; r++)
+        map_mark_static_dirty(&map->rooms[r]);
+}
+
 // ----------------------------------------------------
 void map_transition_room(Map *map, RoomID new_room,
                          int *player_x, int *player_y, Door *door)
 {
     printf("Transitioning to %s\n", map->rooms[new_room].name);
 
+    // Only the current room keeps a static layer; the new one is baked on
+    // its first draw
+    release_static_layer(&map->rooms[map->current_room_id]);
+    map_mark_static_dirty(&map->rooms[new_room]);
+
     map->current_room_id = new_room;
     *player_x = door->spawn_x;
     *player_y = door->spawn_y;
@@ -306,10 +333,12 @@ void map_render_background(Map *map, SDL_Renderer *renderer)
 {
     Room *room = map_get_current_room(map);
 
-    if (room->background_texture)
+    // Reloaded here if it was evicted while the player was elsewhere
+    SDL_Texture *background = residency_acquire(room->background);
+    if (background)
     {
         SDL_Rect dest = {0, 0, WINDOW_WIDTH, WINDOW_HEIGHT};
-        SDL_RenderCopy(renderer, room->background_texture, NULL, &dest);
+        SDL_RenderCopy(renderer, background, NULL, &dest);
     }
 }
 
@@ -320,11 +349,11 @@ void map_cleanup(Map *map)
     {
         Room *room = &map->rooms[r];
 
-        if (room->background_texture)
-        {
-            SDL_DestroyTexture(room->background_texture);
-            room->background_texture = NULL;
-        }
+        // The texture itself is freed by residency_cleanup, which does not
+        // count it as an eviction
+        room->background = RESIDENT_NONE;
+
+        release_static_layer(room);
 
         for (int i = 0; i < room->npc_count; i++)
             sprite_free(&room->npcs[i].sprite);
@@ -3,33 +3,40 @@
 #include <string.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <limits.h>
+
+// Encounter music starts within ENTER tiles of the professor and only stops
+// again at EXIT tiles, so pacing on the boundary does not flip it every step
+#define ENCOUNTER_ENTER_DISTANCE 3
+#define ENCOUNTER_EXIT_DISTANCE 5
+
+// Length of a track switch (fade out + fade in)
+#define MUSIC_CROSSFADE_MS 800
 
 static char current_music_path[128] = "";
 static bool was_near_professor = false;
 
-// Helper function to check if player is near Professor Matthew
-// special music will play when near Professor
-static bool is_near_professor_matthew(Room* room, int player_x, int player_y) {
+// Manhattan distance to Professor Matthew, INT_MAX when he is not around
+// (special music will play when near Professor)
+static int professor_matthew_distance(Room* room, int player_x, int player_y) {
+    int nearest = INT_MAX;
     for (int i = 0; i < room->npc_count; i++) {
         if (strcmp(room->npcs[i].name, "Professor Matthew") == 0 && !room->npcs[i].caught) {
             int dx = abs(player_x - room->npcs[i].x);
             int dy = abs(player_y - room->npcs[i].y);
-            int distance = dx + dy; // Manhattan distance
-            
-            // Within 3 tiles
-            if (distance <= 3) {
-                return true;
+            if (dx + dy < nearest) {
+                nearest = dx + dy;
             }
         }
     }
-    return false;
+    return nearest;
 }
 
 bool music_init(void) {
     printf("Music: Initialization complete (music will start shortly)\n");
     
     // Just set the path, don't load yet
-    strcpy(current_music_path, "assets/music/main_hall.ogg");
+    strcpy(current_music_path, MUSIC_MAIN_HALL_PATH);
     
     return true;
 }
@@ -52,24 +59,23 @@ bool music_start_delayed(void) {
 
 // updates the music depending on what room the player is in / if near professor
 void music_update(Room* current_room, int player_x, int player_y) {
+    // Finish any crossfade in progress
+    audio_update();
+
     // Check if near Professor Matthew for encounter music
-    bool near_professor = is_near_professor_matthew(current_room, player_x, player_y);
+    int distance = professor_matthew_distance(current_room, player_x, player_y);
+    bool near_professor = was_near_professor ? distance < ENCOUNTER_EXIT_DISTANCE
+                                             : distance <= ENCOUNTER_ENTER_DISTANCE;
     
     // Handle music transitions - only when state changes
     if (near_professor && !was_near_professor) {
         // Just entered proximity - switch to encounter music
-        audio_stop_music();
-        audio_load_music("assets/music/matthew.ogg");
-        audio_play_music();
-        audio_set_music_volume(64);
+        audio_crossfade_music(MUSIC_ENCOUNTER_PATH, MUSIC_CROSSFADE_MS);
         was_near_professor = true;
         printf("🎵 Encounter music started!\n");
     } else if (!near_professor && was_near_professor) {
         // Just left proximity - switch back to room music
-        audio_stop_music();
-        audio_load_music(current_music_path);
-        audio_play_music();
-        audio_set_music_volume(64);
+        audio_crossfade_music(current_music_path, MUSIC_CROSSFADE_MS);
         was_near_professor = false;
         printf("🎵 Room music resumed\n");
     }
@@ -80,10 +86,7 @@ void music_change_room(const char* new_music_path) {
     // Only change if different from current
     if (strcmp(current_music_path, new_music_path) != 0) {
         strcpy(current_music_path, new_music_path);
-        audio_stop_music();
-        audio_load_music(current_music_path);
-        audio_play_music();
-        audio_set_music_volume(64);
+        audio_crossfade_music(current_music_path, MUSIC_CROSSFADE_MS);
         was_near_professor = false;  // Reset when changing rooms
         printf("🎵 Changed to room music: %s\n", new_music_path);
     }
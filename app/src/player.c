@@ -172,8 +172,8 @@ void player_render(Player *player, SDL_Renderer *renderer)
         return;
     }
 
-    sprite_render(&player->sprites[player->current_direction], renderer,
-                  (int)player->render_x, (int)player->render_y);
+    sprite_batch_draw(&player->sprites[player->current_direction], renderer,
+                      (int)player->render_x, (int)player->render_y);
 }
 
 void player_cleanup(Player *player)
@@ -0,0 +1,259 @@
+#include "prefetch.h"
+#include "hal/asset_pack.h"
+#include "hal/audio.h"
+#include "hal/image.h"
+#include "hal/residency.h"
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define PREFETCH_PATH_MAX 128
+
+typedef enum
+{
+    SLOT_IDLE,
+    SLOT_QUEUED,   // waiting for the worker
+    SLOT_LOADING,  // the worker is reading it
+    SLOT_DECODED   // background decoded, waiting for the upload
+} SlotState;
+
+// One slot per room: a room is warmed at most once per approach
+typedef struct
+{
+    SlotState state; // guarded by lock
+    bool near;       // a door to the room was in range last frame (main thread)
+
+    // job, filled in by the main thread before the slot is queued
+    ResidentTexture background;
+    char image_path[PREFETCH_PATH_MAX]; // empty when the background is resident
+    int output_w;
+    int output_h;
+    char music_path[PREFETCH_PATH_MAX]; // empty when the music is ready
+
+    SDL_Surface *surface; // worker result, read once the slot is SLOT_DECODED
+} PrefetchSlot;
+
+static SDL_Renderer *prefetch_renderer = NULL;
+static bool music_enabled = false;
+static PrefetchSlot slots[ROOM_COUNT];
+static PrefetchStats stats = {0};
+
+static pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t wake = PTHREAD_COND_INITIALIZER;
+static pthread_t worker;
+static bool worker_running = false; // guarded by lock
+
+static PrefetchSlot *next_queued(void)
+{
+    for (int i = 0; i < ROOM_COUNT; i++)
+    {
+        if (slots[i].state == SLOT_QUEUED)
+            return &slots[i];
+    }
+    return NULL;
+}
+
+// Reads the background to the size it is uploaded at, and opens the music
+// after faulting its pages in, so neither costs the main thread disk time
+static void *worker_main(void *arg)
+{
+    (void)arg;
+
+    pthread_mutex_lock(&lock);
+    while (worker_running)
+    {
+        PrefetchSlot *slot = next_queued();
+        if (!slot)
+        {
+            pthread_cond_wait(&wake, &lock);
+            continue;
+        }
+        slot->state = SLOT_LOADING;
+        pthread_mutex_unlock(&lock);
+
+        SDL_Surface *surface = NULL;
+        if (slot->image_path[0] != '\0')
+        {
+            surface = image_read_surface(slot->image_path);
+            if (surface)
+                surface = image_fit_size(surface, slot->output_w, slot->output_h);
+        }
+
+        if (slot->music_path[0] != '\0')
+        {
+            asset_pack_warm(slot->music_path);
+            audio_prefetch_music(slot->music_path);
+        }
+
+        pthread_mutex_lock(&lock);
+        slot->surface = surface;
+        slot->state = surface ? SLOT_DECODED : SLOT_IDLE;
+    }
+    pthread_mutex_unlock(&lock);
+    return NULL;
+}
+
+bool prefetch_init(SDL_Renderer *renderer, bool prefetch_music)
+{
+    if (!renderer)
+        return false;
+
+    prefetch_renderer = renderer;
+    music_enabled = prefetch_music;
+    memset(slots, 0, sizeof(slots));
+    memset(&stats, 0, sizeof(stats));
+
+    worker_running = true;
+    if (pthread_create(&worker, NULL, worker_main, NULL) != 0)
+    {
+        fprintf(stderr, "Prefetch: Failed to start worker thread\n");
+        worker_running = false;
+        return false;
+    }
+
+    printf("Prefetch: Warming rooms within %d tiles of a door\n", PREFETCH_DOOR_DISTANCE);
+    return true;
+}
+
+// Fills in and queues the slot for a room if anything in it is cold
+static void request_room(PrefetchSlot *slot, Room *room)
+{
+    const char *image_path = NULL;
+    if (!residency_is_resident(room->background))
+    {
+        int logical_w = 0;
+        int logical_h = 0;
+        image_path = residency_get_source(room->background, &logical_w, &logical_h);
+        image_output_size(prefetch_renderer, logical_w, logical_h,
+                          &slot->output_w, &slot->output_h);
+    }
+
+    bool want_music = music_enabled && !audio_music_is_ready(room->music_path);
+    if (!image_path && !want_music)
+        return;
+
+    slot->background = room->background;
+    snprintf(slot->image_path, sizeof(slot->image_path), "%s", image_path ? image_path : "");
+    snprintf(slot->music_path, sizeof(slot->music_path), "%s", want_music ? room->music_path : "");
+
+    pthread_mutex_lock(&lock);
+    slot->state = SLOT_QUEUED;
+    pthread_cond_signal(&wake);
+    pthread_mutex_unlock(&lock);
+
+    stats.requests++;
+    printf("Prefetch: Warming %s\n", room->name);
+}
+
+void prefetch_update(Map *map, int player_x, int player_y)
+{
+    if (!worker_running)
+        return;
+
+    Room *room = map_get_current_room(map);
+
+    // Which rooms the player is about to walk into
+    bool near[ROOM_COUNT] = {false};
+    for (int i = 0; i < room->door_count; i++)
+    {
+        const Door *door = &room->doors[i];
+        if (abs(player_x - door->x) + abs(player_y - door->y) <= PREFETCH_DOOR_DISTANCE)
+            near[door->target_room] = true;
+    }
+
+    // Queue on entering the range only, so a failed load is not retried
+    // every frame
+    for (int i = 0; i < ROOM_COUNT; i++)
+    {
+        PrefetchSlot *slot = &slots[i];
+        if (near[i] && !slot->near)
+        {
+            // Only this thread moves a slot out of idle, so it stays idle
+            // once seen idle here
+            pthread_mutex_lock(&lock);
+            bool idle = slot->state == SLOT_IDLE;
+            pthread_mutex_unlock(&lock);
+
+            if (idle)
+                request_room(slot, &map->rooms[i]);
+        }
+        slot->near = near[i];
+    }
+
+    // Upload at most one finished background per frame
+    for (int i = 0; i < ROOM_COUNT; i++)
+    {
+        PrefetchSlot *slot = &slots[i];
+        SDL_Surface *surface = NULL;
+
+        pthread_mutex_lock(&lock);
+        if (slot->state == SLOT_DECODED)
+        {
+            surface = slot->surface;
+            slot->surface = NULL;
+            slot->state = SLOT_IDLE;
+        }
+        pthread_mutex_unlock(&lock);
+
+        if (surface)
+        {
+            SDL_Texture *texture = image_create_texture(prefetch_renderer, surface);
+            SDL_FreeSurface(surface);
+            if (texture)
+                residency_adopt(slot->background, texture);
+            break;
+        }
+    }
+}
+
+void prefetch_room_entered(Room *room)
+{
+    if (!worker_running)
+        return;
+
+    if (residency_is_resident(room->background))
+        stats.texture_hits++;
+    else
+        stats.texture_misses++;
+
+    if (music_enabled)
+    {
+        if (audio_music_is_ready(room->music_path))
+            stats.music_hits++;
+        else
+            stats.music_misses++;
+    }
+}
+
+void prefetch_get_stats(PrefetchStats *out)
+{
+    if (out)
+        *out = stats;
+}
+
+void prefetch_cleanup(void)
+{
+    pthread_mutex_lock(&lock);
+    bool was_running = worker_running;
+    worker_running = false;
+    pthread_cond_signal(&wake);
+    pthread_mutex_unlock(&lock);
+
+    if (!was_running)
+        return;
+
+    pthread_join(worker, NULL);
+
+    for (int i = 0; i < ROOM_COUNT; i++)
+    {
+        SDL_FreeSurface(slots[i].surface);
+        slots[i].surface = NULL;
+        slots[i].state = SLOT_IDLE;
+    }
+
+    printf("Prefetch: %lu requests, backgrounds %lu hits / %lu misses, music %lu hits / %lu misses\n",
+           stats.requests, stats.texture_hits, stats.texture_misses,
+           stats.music_hits, stats.music_misses);
+    prefetch_renderer = NULL;
+}
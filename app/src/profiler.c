@@ -0,0 +1,290 @@
+#include "profiler.h"
+#include "common.h"
+#include "dialogue.h"
+#include "text_cache.h"
+#include "hal/display.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Overlay placement (logical coordinates, right side of the screen)
+#define GRAPH_H 220
+#define GRAPH_MAX_MS 66.0      // frame time at the top of the graph
+#define TEXT_REFRESH_MS 500    // how often the numbers are re-rasterized
+#define TEXT_LINE_HEIGHT 56
+#define OVERLAY_W 760
+#define OVERLAY_H (GRAPH_H + 30 + (PROFILE_PHASE_COUNT + 1) * TEXT_LINE_HEIGHT)
+#define OVERLAY_X (WINDOW_WIDTH - OVERLAY_W - 20)
+#define OVERLAY_Y 90
+
+static const char *PHASE_NAMES[PROFILE_PHASE_COUNT] = {
+    "events", "input", "music", "update", "render", "text", "present", "wait"};
+
+static const SDL_Color PHASE_COLORS[PROFILE_PHASE_COUNT] = {
+    {90, 160, 255, 255},  // events
+    {80, 220, 220, 255},  // input
+    {200, 120, 255, 255}, // music
+    {100, 220, 100, 255}, // update
+    {255, 200, 60, 255},  // render
+    {255, 120, 40, 255},  // text
+    {255, 70, 70, 255},   // present
+    {110, 110, 110, 255}  // wait
+};
+
+// history ring, in ticks of the performance counter
+static Uint32 history[PROFILER_HISTORY][PROFILE_PHASE_COUNT];
+static int history_head = 0;
+static int history_count = 0;
+
+static Uint32 current[PROFILE_PHASE_COUNT];
+static Uint64 last_mark = 0;
+static Uint64 nested_ticks = 0; // nested time since last_mark
+static bool frame_open = false;
+static double ticks_to_ms = 0.0;
+
+static bool overlay_visible = false;
+static bool overlay_was_visible = false;
+static Uint32 last_text_update = 0;
+static char overlay_lines[PROFILE_PHASE_COUNT + 1][64];
+
+Uint64 profiler_now(void)
+{
+    return SDL_GetPerformanceCounter();
+}
+
+void profiler_init(void)
+{
+    memset(history, 0, sizeof(history));
+    memset(current, 0, sizeof(current));
+    history_head = 0;
+    history_count = 0;
+    nested_ticks = 0;
+    frame_open = false;
+    ticks_to_ms = 1000.0 / (double)SDL_GetPerformanceFrequency();
+    last_mark = profiler_now();
+}
+
+void profiler_begin_frame(void)
+{
+    if (frame_open)
+    {
+        memcpy(history[history_head], current, sizeof(current));
+        history_head = (history_head + 1) % PROFILER_HISTORY;
+        if (history_count < PROFILER_HISTORY)
+            history_count++;
+    }
+
+    memset(current, 0, sizeof(current));
+    nested_ticks = 0;
+    frame_open = true;
+    last_mark = profiler_now();
+}
+
+void profiler_mark(ProfilePhase phase)
+{
+    Uint64 now = profiler_now();
+    Uint64 elapsed = now - last_mark;
+
+    elapsed = elapsed > nested_ticks ? elapsed - nested_ticks : 0;
+    current[phase] += (Uint32)elapsed;
+
+    nested_ticks = 0;
+    last_mark = now;
+}
+
+void profiler_add_nested(ProfilePhase phase, Uint64 start)
+{
+    Uint64 elapsed = profiler_now() - start;
+    current[phase] += (Uint32)elapsed;
+    nested_ticks += elapsed;
+}
+
+static int compare_double(const void *a, const void *b)
+{
+    double da = *(const double *)a;
+    double db = *(const double *)b;
+    return (da > db) - (da < db);
+}
+
+// average and 99th percentile of values (sorts them in place)
+static void average_p99(double *values, int count, double *average, double *p99)
+{
+    double sum = 0.0;
+    for (int i = 0; i < count; i++)
+        sum += values[i];
+
+    qsort(values, count, sizeof(values[0]), compare_double);
+
+    int index = (count * 99) / 100;
+    if (index >= count)
+        index = count - 1;
+
+    *average = sum / count;
+    *p99 = values[index];
+}
+
+void profiler_get_summary(ProfilerSummary *summary)
+{
+    if (!summary)
+        return;
+
+    memset(summary, 0, sizeof(*summary));
+    summary->frames = history_count;
+    if (history_count == 0)
+        return;
+
+    double values[PROFILER_HISTORY];
+    double totals[PROFILER_HISTORY] = {0};
+
+    for (int p = 0; p < PROFILE_PHASE_COUNT; p++)
+    {
+        for (int i = 0; i < history_count; i++)
+        {
+            values[i] = history[i][p] * ticks_to_ms;
+            totals[i] += values[i];
+        }
+        average_p99(values, history_count, &summary->average_ms[p], &summary->p99_ms[p]);
+    }
+
+    average_p99(totals, history_count, &summary->frame_average_ms, &summary->frame_p99_ms);
+}
+
+void profiler_toggle_overlay(void)
+{
+    overlay_visible = !overlay_visible;
+    last_text_update = 0;
+}
+
+bool profiler_overlay_visible(void)
+{
+    return overlay_visible;
+}
+
+void profiler_mark_damage(void)
+{
+    // repaint while shown, and once more to erase it after hiding
+    if (overlay_visible || overlay_was_visible)
+    {
+        SDL_Rect area = {OVERLAY_X, OVERLAY_Y, OVERLAY_W, OVERLAY_H};
+        display_damage_rect(&area);
+    }
+    overlay_was_visible = overlay_visible;
+}
+
+// stacked bar per frame, one fill call per phase colour
+static void draw_graph(SDL_Renderer *renderer, const SDL_Rect *graph)
+{
+    static SDL_Rect bars[PROFILE_PHASE_COUNT][PROFILER_HISTORY];
+    int bar_counts[PROFILE_PHASE_COUNT] = {0};
+
+    float bar_w = (float)graph->w / PROFILER_HISTORY;
+    double px_per_ms = graph->h / GRAPH_MAX_MS;
+
+    for (int i = 0; i < history_count; i++)
+    {
+        // oldest frame on the left
+        int index = (history_head - history_count + i + PROFILER_HISTORY) % PROFILER_HISTORY;
+        int x = graph->x + (int)(i * bar_w);
+        int w = (int)((i + 1) * bar_w) - (int)(i * bar_w);
+        double base_ms = 0.0;
+
+        for (int p = 0; p < PROFILE_PHASE_COUNT; p++)
+        {
+            double ms = history[index][p] * ticks_to_ms;
+            if (ms <= 0.0 || base_ms >= GRAPH_MAX_MS)
+                continue;
+
+            int y0 = (int)(base_ms * px_per_ms);
+            int y1 = (int)((base_ms + ms) * px_per_ms);
+            if (y1 > graph->h)
+                y1 = graph->h;
+            base_ms += ms;
+
+            if (y1 > y0)
+                bars[p][bar_counts[p]++] = (SDL_Rect){x, graph->y + graph->h - y1, w, y1 - y0};
+        }
+    }
+
+    for (int p = 0; p < PROFILE_PHASE_COUNT; p++)
+    {
+        if (bar_counts[p] == 0)
+            continue;
+        SDL_Color c = PHASE_COLORS[p];
+        SDL_SetRenderDrawColor(renderer, c.r, c.g, c.b, c.a);
+        SDL_RenderFillRects(renderer, bars[p], bar_counts[p]);
+    }
+
+    // frame budget line
+    int budget_y = graph->y + graph->h - (int)((1000.0 / TARGET_FPS) * px_per_ms);
+    SDL_SetRenderDrawColor(renderer, 255, 255, 255, 255);
+    SDL_RenderDrawLine(renderer, graph->x, budget_y, graph->x + graph->w, budget_y);
+}
+
+static void update_text(void)
+{
+    ProfilerSummary summary;
+    profiler_get_summary(&summary);
+
+    snprintf(overlay_lines[0], sizeof(overlay_lines[0]), "frame  %5.2f avg  %5.2f p99 ms",
+             summary.frame_average_ms, summary.frame_p99_ms);
+
+    for (int p = 0; p < PROFILE_PHASE_COUNT; p++)
+    {
+        snprintf(overlay_lines[p + 1], sizeof(overlay_lines[p + 1]), "%-8s %5.2f  %5.2f",
+                 PHASE_NAMES[p], summary.average_ms[p], summary.p99_ms[p]);
+    }
+}
+
+void profiler_draw_overlay(SDL_Renderer *renderer)
+{
+    if (!overlay_visible || !renderer)
+        return;
+
+    // numbers change every frame; re-rasterizing them twice a second keeps
+    // the overlay from churning the text cache
+    Uint32 now = SDL_GetTicks();
+    if (last_text_update == 0 || now - last_text_update >= TEXT_REFRESH_MS)
+    {
+        update_text();
+        last_text_update = now;
+    }
+
+    SDL_Rect panel = {OVERLAY_X, OVERLAY_Y, OVERLAY_W, OVERLAY_H};
+    SDL_SetRenderDrawBlendMode(renderer, SDL_BLENDMODE_BLEND);
+    SDL_SetRenderDrawColor(renderer, 0, 0, 0, 190);
+    SDL_RenderFillRect(renderer, &panel);
+    SDL_SetRenderDrawBlendMode(renderer, SDL_BLENDMODE_NONE);
+
+    SDL_Rect graph = {panel.x + 10, panel.y + 10, panel.w - 20, GRAPH_H};
+    draw_graph(renderer, &graph);
+
+    TTF_Font *font = dialogue_get_quest_font();
+    if (!font)
+        return;
+
+    int y = graph.y + graph.h + 10;
+    SDL_Color white = {255, 255, 255, 255};
+    text_cache_draw(font, overlay_lines[0], white, 0, panel.x + 10, y);
+
+    for (int p = 0; p < PROFILE_PHASE_COUNT; p++)
+    {
+        y += TEXT_LINE_HEIGHT;
+        text_cache_draw(font, overlay_lines[p + 1], PHASE_COLORS[p], 0, panel.x + 10, y);
+    }
+}
+
+void profiler_cleanup(void)
+{
+    ProfilerSummary summary;
+    profiler_get_summary(&summary);
+    if (summary.frames == 0)
+        return;
+
+    printf("Profiler: last %d frames, %.2f ms avg, %.2f ms p99\n",
+           summary.frames, summary.frame_average_ms, summary.frame_p99_ms);
+    for (int p = 0; p < PROFILE_PHASE_COUNT; p++)
+    {
+        printf("  %-8s %6.2f ms avg  %6.2f ms p99\n",
+               PHASE_NAMES[p], summary.average_ms[p], summary.p99_ms[p]);
+    }
+}
@@ -2,10 +2,15 @@
 #include "common.h"
 #include "quest.h"
 #include "dialogue.h"   // gives access to dialogue_get_font()
+#include "text_cache.h"
 #include <SDL2/SDL_ttf.h>
 #include "hal/display.h"
+#include "hal/residency.h"
+#include "hal/image.h"
 #include <SDL2/SDL.h>
 #include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
 
 // void rendering_draw_obstacles(int obstacles[][GRID_WIDTH]) {
 //     SDL_Renderer* renderer = display_get_renderer();
@@ -31,9 +36,9 @@ void rendering_draw_npcs(NPC *npcs, int count)
         {
 
             // Just render the NPC sprite (no highlight, no interaction)
-            sprite_render(&npcs[i].sprite, renderer,
-                          npcs[i].x * TILE_SIZE,
-                          npcs[i].y * TILE_SIZE);
+            sprite_batch_draw(&npcs[i].sprite, renderer,
+                              npcs[i].x * TILE_SIZE,
+                              npcs[i].y * TILE_SIZE);
         }
     }
 }
@@ -76,20 +81,86 @@ void rendering_draw_doors(Door *doors, int door_count)
     }
 }
 
-void rendering_draw_quest(SDL_Renderer* renderer)
+// ----------------------------------------------------
+// Static room layer
+// ----------------------------------------------------
+
+// everything in a room that does not move between frames
+static void draw_static_elements(SDL_Renderer *renderer, Map *map, Room *room)
 {
-    if (!quest_any_active())
-        return;
+    map_render_background(map, renderer);
 
-    int start_x = 20;
-    int start_y = 1100;   // bottom-left area for 800x480
-    int line_height = 40;
+    rendering_draw_doors(room->doors, room->door_count);
 
-    TTF_Font* font = dialogue_get_quest_font();
-    if (!font)
+    sprite_batch_begin(renderer);
+    rendering_draw_npcs(room->npcs, room->npc_count);
+    sprite_batch_end();
+}
+
+// bakes the static elements into the room's layer at output resolution
+static bool build_static_layer(SDL_Renderer *renderer, Map *map, Room *room)
+{
+    int w, h;
+    image_output_size(renderer, WINDOW_WIDTH, WINDOW_HEIGHT, &w, &h);
+
+    if (!room->static_layer)
+    {
+        if (!SDL_RenderTargetSupported(renderer))
+            return false;
+
+        room->static_layer = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_ARGB8888,
+                                               SDL_TEXTUREACCESS_TARGET, w, h);
+        if (!room->static_layer)
+        {
+            fprintf(stderr, "Failed to create static layer for %s: %s\n",
+                    room->name, SDL_GetError());
+            return false;
+        }
+
+        // opaque: copied without blending
+        SDL_SetTextureBlendMode(room->static_layer, SDL_BLENDMODE_NONE);
+        residency_track(room->static_layer);
+    }
+
+    if (!display_push_target(room->static_layer))
+        return false;
+
+    SDL_RenderSetScale(renderer, (float)w / WINDOW_WIDTH, (float)h / WINDOW_HEIGHT);
+    SDL_SetRenderDrawColor(renderer, 0, 0, 0, 255);
+    SDL_RenderClear(renderer);
+    draw_static_elements(renderer, map, room);
+
+    display_pop_target();
+
+    room->static_dirty = false;
+    return true;
+}
+
+void rendering_draw_room_static(SDL_Renderer *renderer, Map *map, Room *room)
+{
+    if ((room->static_dirty || !room->static_layer) &&
+        !build_static_layer(renderer, map, room))
+    {
+        // No render-target support: draw the elements every frame
+        display_clear(0, 0, 0);
+        draw_static_elements(renderer, map, room);
         return;
+    }
 
-    SDL_Color black = {0, 0, 0, 255};   // Main text only
+    SDL_Rect dest = {0, 0, WINDOW_WIDTH, WINDOW_HEIGHT};
+    SDL_RenderCopy(renderer, room->static_layer, NULL, &dest);
+}
+
+#define QUEST_START_X 20
+#define QUEST_START_Y 1100   // bottom-left area for 800x480
+#define QUEST_LINE_HEIGHT 40
+#define QUEST_LINE_MAX 256
+
+// formats one line per active quest, returns the number of lines
+static int build_quest_lines(char lines[QUEST_COUNT][QUEST_LINE_MAX])
+{
+    if (!quest_any_active())
+        return 0;
 
     QuestID list[QUEST_COUNT];
     int count = quest_get_active_list(list, QUEST_COUNT);
@@ -97,26 +168,186 @@ void rendering_draw_quest(SDL_Renderer* renderer)
     for (int i = 0; i < count; i++)
     {
         QuestID q = list[i];
-
-        char buffer[256];
-        snprintf(buffer, sizeof(buffer),
+        snprintf(lines[i], QUEST_LINE_MAX,
                  "%s (%d/%d)",
                  quest_get_desc(q),
                  quest_get_progress(q),
                  quest_get_needed(q));
+    }
+    return count;
+}
+
+void rendering_draw_quest(SDL_Renderer* renderer)
+{
+    TTF_Font* font = dialogue_get_quest_font();
+    if (!font)
+        return;
 
-        int y = start_y + (i * line_height);
+    SDL_Color black = {0, 0, 0, 255};   // Main text only
 
-        // ---- MAIN TEXT (BLACK, NO SHADOW) ----
-        SDL_Surface* surf = TTF_RenderUTF8_Blended(font, buffer, black);
-        if (!surf) continue;
+    char lines[QUEST_COUNT][QUEST_LINE_MAX];
+    int count = build_quest_lines(lines);
 
-        SDL_Texture* tex = SDL_CreateTextureFromSurface(renderer, surf);
+    for (int i = 0; i < count; i++)
+    {
+        int y = QUEST_START_Y + (i * QUEST_LINE_HEIGHT);
 
-        SDL_Rect dst = {start_x, y, surf->w, surf->h};
-        SDL_FreeSurface(surf);
+        // ---- MAIN TEXT (BLACK, NO SHADOW) ----
+        // cached: only re-rasterized when the progress numbers change
+        int w = 0;
+        int h = 0;
+        SDL_Texture* tex = text_cache_get(font, lines[i], black, 0, &w, &h);
+        if (!tex) continue;
 
+        SDL_Rect dst = {QUEST_START_X, y, w, h};
         SDL_RenderCopy(renderer, tex, NULL, &dst);
-        SDL_DestroyTexture(tex);
     }
 }
+
+// ----------------------------------------------------
+// Damage tracking
+// ----------------------------------------------------
+typedef struct
+{
+    bool visible;
+    SDL_Rect rect;       // sprite plus highlight
+    bool highlighted;
+} PetSnapshot;
+
+typedef struct
+{
+    bool valid;
+    int room_id;
+    bool overlay;
+    SDL_Rect player_rect;
+    int player_direction;
+    PetSnapshot pets[MAX_PETS];
+    Uint32 quest_hash;
+    SDL_Rect quest_rect;
+} SceneSnapshot;
+
+static SceneSnapshot last_scene;
+
+static Uint32 hash_text(Uint32 h, const char *text)
+{
+    for (const unsigned char *p = (const unsigned char *)text; *p; p++)
+    {
+        h ^= *p;
+        h *= 16777619u;
+    }
+    return h;
+}
+
+static bool rect_equal(const SDL_Rect *a, const SDL_Rect *b)
+{
+    return a->x == b->x && a->y == b->y && a->w == b->w && a->h == b->h;
+}
+
+// damages both where something was and where it is now
+static void damage_change(const SDL_Rect *before, const SDL_Rect *after)
+{
+    display_damage_rect(before);
+    display_damage_rect(after);
+}
+
+static void capture_scene(SceneSnapshot *scene, Room *room, PetManager *pets,
+                          Player *player, bool overlay)
+{
+    memset(scene, 0, sizeof(*scene));
+    scene->valid = true;
+    scene->room_id = room->id;
+    scene->overlay = overlay;
+
+    Sprite *player_sprite = &player->sprites[player->current_direction];
+    scene->player_rect = (SDL_Rect){(int)player->render_x, (int)player->render_y,
+                                    player_sprite->width, player_sprite->height};
+    scene->player_direction = player->current_direction;
+
+    // mirrors pet_render_all
+    for (int i = 0; i < pets->count && i < MAX_PETS; i++)
+    {
+        Pet *pet = &pets->pets[i];
+        PetSnapshot *snap = &scene->pets[i];
+        if (pet->caught || pet->room_id != (int)room->id)
+            continue;
+
+        int dx = abs(player->grid_x - pet->x);
+        int dy = abs(player->grid_y - pet->y);
+
+        snap->visible = true;
+        snap->highlighted = (dx == 1 && dy == 0) || (dx == 0 && dy == 1);
+
+        SDL_Rect sprite_rect = {pet->x * TILE_SIZE, pet->y * TILE_SIZE,
+                                pet->sprite.width, pet->sprite.height};
+        SDL_Rect highlight = {pet->x * TILE_SIZE - 2, pet->y * TILE_SIZE - 2,
+                              TILE_SIZE + 4, TILE_SIZE + 4};
+        SDL_UnionRect(&sprite_rect, &highlight, &snap->rect);
+    }
+
+    // mirrors rendering_draw_quest
+    TTF_Font *font = dialogue_get_quest_font();
+    char lines[QUEST_COUNT][QUEST_LINE_MAX];
+    int count = build_quest_lines(lines);
+    Uint32 h = 2166136261u;
+
+    for (int i = 0; i < count; i++)
+    {
+        h = hash_text(h, lines[i]);
+
+        int w = 0;
+        int th = 0;
+        SDL_Color black = {0, 0, 0, 255};
+        if (!font || !text_cache_measure(font, lines[i], black, 0, &w, &th))
+            continue;
+
+        SDL_Rect line = {QUEST_START_X, QUEST_START_Y + i * QUEST_LINE_HEIGHT, w, th};
+        if (SDL_RectEmpty(&scene->quest_rect))
+            scene->quest_rect = line;
+        else
+            SDL_UnionRect(&scene->quest_rect, &line, &scene->quest_rect);
+    }
+    scene->quest_hash = h;
+}
+
+void rendering_mark_damage(Room *room, PetManager *pets, Player *player, bool overlay)
+{
+    SceneSnapshot scene;
+    capture_scene(&scene, room, pets, player, overlay);
+
+    // A new room, a changed static layer or a full-screen dialogue
+    // changes everything
+    if (!last_scene.valid || scene.room_id != last_scene.room_id ||
+        room->static_dirty || scene.overlay || last_scene.overlay)
+    {
+        display_damage_all();
+        last_scene = scene;
+        return;
+    }
+
+    if (!rect_equal(&scene.player_rect, &last_scene.player_rect) ||
+        scene.player_direction != last_scene.player_direction)
+    {
+        damage_change(&last_scene.player_rect, &scene.player_rect);
+    }
+
+    for (int i = 0; i < MAX_PETS; i++)
+    {
+        PetSnapshot *now = &scene.pets[i];
+        PetSnapshot *before = &last_scene.pets[i];
+
+        if (now->visible == before->visible &&
+            now->highlighted == before->highlighted &&
+            rect_equal(&now->rect, &before->rect))
+            continue;
+
+        if (before->visible)
+            display_damage_rect(&before->rect);
+        if (now->visible)
+            display_damage_rect(&now->rect);
+    }
+
+    if (scene.quest_hash != last_scene.quest_hash)
+        damage_change(&last_scene.quest_rect, &scene.quest_rect);
+
+    last_scene = scene;
+}
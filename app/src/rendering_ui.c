@@ -1,6 +1,9 @@
 #include "rendering_ui.h"
 #include "common.h"
+#include "hal/asset_pack.h"
 #include "hal/display.h"
+#include "hal/residency.h"
+#include "text_cache.h"
 #include <SDL2/SDL.h>
 #include <SDL2/SDL_ttf.h>
 #include <stdio.h>
@@ -9,9 +12,26 @@
 #define UI_PADDING 20
 #define UI_ICON_SIZE 40
 #define UI_TEXT_SPACING 50
+#define UI_LABEL_WIDTH 260
 #define RESET_BUTTON_WIDTH 120
 #define RESET_BUTTON_HEIGHT 40
 
+// Retained HUD widgets. Their rectangles are laid out once and used both to
+// draw the HUD and to hit-test clicks.
+typedef enum {
+    HUD_WIDGET_BEAR_COUNT = PET_BEAR,
+    HUD_WIDGET_RACCOON_COUNT = PET_RACCOON,
+    HUD_WIDGET_DEER_COUNT = PET_DEER,
+    HUD_WIDGET_BIGDEER_COUNT = PET_BIGDEER,
+    HUD_WIDGET_RESET,
+    HUD_WIDGET_COUNT,
+    HUD_WIDGET_NONE = -1
+} HudWidgetID;
+
+typedef struct {
+    SDL_Rect rect; // logical screen coordinates
+} HudWidget;
+
 // Font
 static TTF_Font* ui_font = NULL;
 
@@ -34,8 +54,53 @@ static SDL_Color ANIMAL_COLORS[] = {
     {160, 82, 45, 255}    // Dark brown for big deer
 };
 
-// Reset button rectangle (calculated during draw)
-static SDL_Rect reset_button_rect = {0, 0, RESET_BUTTON_WIDTH, RESET_BUTTON_HEIGHT};
+static HudWidget hud_widgets[HUD_WIDGET_COUNT];
+
+// Cached composite of the catch counters only, covering counter_bounds. The
+// RESET button never changes and sits in the opposite corner, so it is drawn
+// directly: one layer spanning both would blend a window-wide, mostly
+// transparent texture over the scene.
+static SDL_Rect counter_bounds = {0, 0, 0, 0};
+static SDL_Texture* counter_layer = NULL;
+static bool hud_dirty = true;
+
+// computes the widget rectangles and the bounding box of the counter layer
+static void hud_layout(void) {
+    for (int type = 0; type < PET_TYPE_COUNT; type++) {
+        hud_widgets[type].rect = (SDL_Rect){
+            UI_PADDING,
+            UI_PADDING + type * UI_TEXT_SPACING,
+            UI_ICON_SIZE + 10 + UI_LABEL_WIDTH,
+            UI_ICON_SIZE
+        };
+    }
+    
+    // Reset button in top right
+    hud_widgets[HUD_WIDGET_RESET].rect = (SDL_Rect){
+        WINDOW_WIDTH - RESET_BUTTON_WIDTH - UI_PADDING,
+        UI_PADDING,
+        RESET_BUTTON_WIDTH,
+        RESET_BUTTON_HEIGHT
+    };
+    
+    counter_bounds = hud_widgets[0].rect;
+    for (int type = 1; type < PET_TYPE_COUNT; type++) {
+        SDL_Rect merged;
+        SDL_UnionRect(&counter_bounds, &hud_widgets[type].rect, &merged);
+        counter_bounds = merged;
+    }
+}
+
+// returns the widget under a logical point, or HUD_WIDGET_NONE
+static HudWidgetID hud_hit_test(int x, int y) {
+    SDL_Point p = {x, y};
+    for (int i = 0; i < HUD_WIDGET_COUNT; i++) {
+        if (SDL_PointInRect(&p, &hud_widgets[i].rect)) {
+            return (HudWidgetID)i;
+        }
+    }
+    return HUD_WIDGET_NONE;
+}
 
 bool rendering_ui_init(void) {
     // Initialize catch counts to zero
@@ -43,6 +108,9 @@ bool rendering_ui_init(void) {
         total_catches[i] = 0;
     }
     
+    hud_layout();
+    hud_dirty = true;
+    
     // lpading fonts
     const char* font_paths[] = {
         "assets/fonts/Arial.ttf",
@@ -52,7 +120,7 @@ bool rendering_ui_init(void) {
     };
     
     for (int i = 0; i < 4; i++) {
-        ui_font = TTF_OpenFont(font_paths[i], 30);
+        ui_font = TTF_OpenFontRW(asset_open(font_paths[i]), 1, 30);
         if (ui_font) {
             printf("UI: Font loaded from: %s\n", font_paths[i]);
             return true;
@@ -63,14 +131,16 @@ bool rendering_ui_init(void) {
     return false;
 }
 
-static void draw_animal_count(SDL_Renderer* renderer, const char* name, int count, 
-                              SDL_Color color, int y_offset) {
+// (ox, oy) is the origin of the surface being drawn to, in logical coordinates
+static void draw_animal_count(SDL_Renderer* renderer, const SDL_Rect* widget,
+                              const char* name, int count, SDL_Color color,
+                              int ox, int oy) {
     if (!ui_font) return;
     
     // Draw colored box as icon
     SDL_Rect icon_rect = {
-        UI_PADDING,
-        UI_PADDING + y_offset,
+        widget->x - ox,
+        widget->y - oy,
         UI_ICON_SIZE,
         UI_ICON_SIZE
     };
@@ -86,61 +156,92 @@ static void draw_animal_count(SDL_Renderer* renderer, const char* name, int coun
     snprintf(text, sizeof(text), "%s: %d", name, count);
     
     SDL_Color black = {0, 0, 0, 255};
-    SDL_Surface* text_surface = TTF_RenderText_Blended(ui_font, text, black);
-    
-    if (text_surface) {
-        SDL_Texture* text_texture = SDL_CreateTextureFromSurface(renderer, text_surface);
-        
-        if (text_texture) {
-            SDL_Rect text_rect = {
-                UI_PADDING + UI_ICON_SIZE + 10,
-                UI_PADDING + y_offset + (UI_ICON_SIZE - text_surface->h) / 2,
-                text_surface->w,
-                text_surface->h
-            };
-            SDL_RenderCopy(renderer, text_texture, NULL, &text_rect);
-            SDL_DestroyTexture(text_texture);
-        }
-        
-        SDL_FreeSurface(text_surface);
+    int text_w = 0;
+    int text_h = 0;
+    SDL_Texture* text_texture = text_cache_get(ui_font, text, black, 0, &text_w, &text_h);
+    
+    if (text_texture) {
+        SDL_Rect text_rect = {
+            icon_rect.x + UI_ICON_SIZE + 10,
+            icon_rect.y + (UI_ICON_SIZE - text_h) / 2,
+            text_w,
+            text_h
+        };
+        SDL_RenderCopy(renderer, text_texture, NULL, &text_rect);
     }
 }
 
 static void draw_reset_button(SDL_Renderer* renderer) {
     if (!ui_font) return;
     
-    // Position button in top right
-    reset_button_rect.x = WINDOW_WIDTH - RESET_BUTTON_WIDTH - UI_PADDING;
-    reset_button_rect.y = UI_PADDING;
+    const SDL_Rect* button_rect = &hud_widgets[HUD_WIDGET_RESET].rect;
     
     // Draw button background (red)
     SDL_SetRenderDrawColor(renderer, 200, 50, 50, 255);
-    SDL_RenderFillRect(renderer, &reset_button_rect);
+    SDL_RenderFillRect(renderer, button_rect);
     
     // Draw button border (white)
     SDL_SetRenderDrawColor(renderer, 255, 255, 255, 255);
-    SDL_RenderDrawRect(renderer, &reset_button_rect);
+    SDL_RenderDrawRect(renderer, button_rect);
     
     // Draw button text
     SDL_Color white = {255, 255, 255, 255};
-    SDL_Surface* text_surface = TTF_RenderText_Solid(ui_font, "RESET", white);
-    
-    if (text_surface) {
-        SDL_Texture* text_texture = SDL_CreateTextureFromSurface(renderer, text_surface);
-        
-        if (text_texture) {
-            SDL_Rect text_rect = {
-                reset_button_rect.x + (RESET_BUTTON_WIDTH - text_surface->w) / 2,
-                reset_button_rect.y + (RESET_BUTTON_HEIGHT - text_surface->h) / 2,
-                text_surface->w,
-                text_surface->h
-            };
-            SDL_RenderCopy(renderer, text_texture, NULL, &text_rect);
-            SDL_DestroyTexture(text_texture);
+    int text_w = 0;
+    int text_h = 0;
+    SDL_Texture* text_texture = text_cache_get(ui_font, "RESET", white, 0, &text_w, &text_h);
+    
+    if (text_texture) {
+        SDL_Rect text_rect = {
+            button_rect->x + (RESET_BUTTON_WIDTH - text_w) / 2,
+            button_rect->y + (RESET_BUTTON_HEIGHT - text_h) / 2,
+            text_w,
+            text_h
+        };
+        SDL_RenderCopy(renderer, text_texture, NULL, &text_rect);
+    }
+}
+
+// draws the catch counters relative to origin (ox, oy)
+static void draw_counters(SDL_Renderer* renderer, int ox, int oy) {
+    // Draw each animal count in the top left using our tracked totals
+    for (int type = 0; type < PET_TYPE_COUNT; type++) {
+        draw_animal_count(renderer, &hud_widgets[type].rect, ANIMAL_NAMES[type],
+                          total_catches[type], ANIMAL_COLORS[type], ox, oy);
+    }
+}
+
+// re-renders the counters into the cached layer
+static bool hud_rebuild(SDL_Renderer* renderer) {
+    if (!counter_layer) {
+        if (!SDL_RenderTargetSupported(renderer)) {
+            return false;
+        }
+    
+        counter_layer = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_RGBA8888,
+                                          SDL_TEXTUREACCESS_TARGET,
+                                          counter_bounds.w, counter_bounds.h);
+        if (!counter_layer) {
+            fprintf(stderr, "UI: Failed to create HUD layer: %s\n", SDL_GetError());
+            return false;
         }
-        
-        SDL_FreeSurface(text_surface);
+        SDL_SetTextureBlendMode(counter_layer, SDL_BLENDMODE_BLEND);
+        residency_track(counter_layer);
+    }
+    
+    // The frame may be drawing into the display's scaled back buffer, so
+    // the target is switched through the display's target stack
+    if (!display_push_target(counter_layer)) {
+        fprintf(stderr, "UI: Failed to bind HUD layer: %s\n", SDL_GetError());
+        return false;
     }
+    
+    SDL_SetRenderDrawColor(renderer, 0, 0, 0, 0);
+    SDL_RenderClear(renderer);
+    draw_counters(renderer, counter_bounds.x, counter_bounds.y);
+    
+    display_pop_target();
+    hud_dirty = false;
+    return true;
 }
 
 void rendering_ui_draw_hud(PetManager* manager) {
@@ -149,29 +250,39 @@ void rendering_ui_draw_hud(PetManager* manager) {
     SDL_Renderer* renderer = display_get_renderer();
     if (!renderer) return;
     
-    // Draw each animal count in the top left using our tracked totals
-    for (int type = 0; type < PET_TYPE_COUNT; type++) {
-        draw_animal_count(renderer, ANIMAL_NAMES[type], total_catches[type],
-                         ANIMAL_COLORS[type], type * UI_TEXT_SPACING);
+    if (hud_dirty && !hud_rebuild(renderer)) {
+        // No render-target support: fall back to immediate drawing
+        draw_counters(renderer, 0, 0);
+    } else {
+        SDL_RenderCopy(renderer, counter_layer, NULL, &counter_bounds);
     }
     
     // Draw reset button in top right
     draw_reset_button(renderer);
 }
 
+void rendering_ui_mark_dirty(void) {
+    hud_dirty = true;
+}
+
+void rendering_ui_mark_damage(void) {
+    // Only the counters change
+    if (hud_dirty) {
+        display_damage_rect(&counter_bounds);
+    }
+}
+
 void rendering_ui_increment_catch(PetType type) {
     if (type >= 0 && type < PET_TYPE_COUNT) {
         total_catches[type]++;
+        hud_dirty = true;
         printf("UI: Caught %s - Total: %d\n", ANIMAL_NAMES[type], total_catches[type]);
     }
 }
 
 bool rendering_ui_check_reset_click(int mouse_x, int mouse_y) {
-    // Check if click is within reset button bounds
-    return (mouse_x >= reset_button_rect.x && 
-            mouse_x <= reset_button_rect.x + reset_button_rect.w &&
-            mouse_y >= reset_button_rect.y && 
-            mouse_y <= reset_button_rect.y + reset_button_rect.h);
+    // Hit-test against the same retained layout the HUD is drawn from
+    return hud_hit_test(mouse_x, mouse_y) == HUD_WIDGET_RESET;
 }
 
 void rendering_ui_reset_catches(PetManager* manager) {
@@ -183,11 +294,19 @@ void rendering_ui_reset_catches(PetManager* manager) {
     for (int i = 0; i < PET_TYPE_COUNT; i++) {
         total_catches[i] = 0;
     }
+    hud_dirty = true;
     
     printf("UI: Reset complete - all counts cleared!\n");
 }
 
 void rendering_ui_cleanup(void) {
+    if (counter_layer) {
+        residency_untrack(counter_layer);
+        SDL_DestroyTexture(counter_layer);
+        counter_layer = NULL;
+    }
+    hud_dirty = true;
+    
     if (ui_font) {
         TTF_CloseFont(ui_font);
         ui_font = NULL;
@@ -0,0 +1,246 @@
+#include "replay.h"
+#include <stdio.h>
+#include <string.h>
+
+// File layout (little endian):
+//   header: "SFRP", u16 version, u16 reserved, u32 seed, u32 frame count
+//   frames: u8 flags, u8 or u32 time delta (ms), [s16 x, s16 y if clicked]
+// A typical frame is two bytes.
+#define REPLAY_MAGIC "SFRP"
+#define REPLAY_VERSION 1
+#define REPLAY_HEADER_SIZE 16
+#define REPLAY_FRAME_COUNT_OFFSET 12
+
+#define FLAG_DIRECTION_MASK 0x07
+#define FLAG_CATCH 0x08
+#define FLAG_INTERACT 0x10
+#define FLAG_RESET 0x20
+#define FLAG_CLICK 0x40
+#define FLAG_LONG_DELTA 0x80
+
+typedef enum
+{
+    REPLAY_IDLE,
+    REPLAY_RECORDING,
+    REPLAY_PLAYING
+} ReplayState;
+
+static ReplayState state = REPLAY_IDLE;
+static FILE *file = NULL;
+static Uint32 frame_count = 0;
+static Uint32 frames_done = 0;
+static Uint32 last_time = 0;
+
+static void write_u16(Uint16 v)
+{
+    Uint8 b[2] = {(Uint8)v, (Uint8)(v >> 8)};
+    fwrite(b, 1, sizeof(b), file);
+}
+
+static void write_u32(Uint32 v)
+{
+    Uint8 b[4] = {(Uint8)v, (Uint8)(v >> 8), (Uint8)(v >> 16), (Uint8)(v >> 24)};
+    fwrite(b, 1, sizeof(b), file);
+}
+
+static bool read_bytes(Uint8 *b, size_t n)
+{
+    return fread(b, 1, n, file) == n;
+}
+
+static bool read_u16(Uint16 *v)
+{
+    Uint8 b[2];
+    if (!read_bytes(b, sizeof(b)))
+        return false;
+    *v = (Uint16)(b[0] | (b[1] << 8));
+    return true;
+}
+
+static bool read_u32(Uint32 *v)
+{
+    Uint8 b[4];
+    if (!read_bytes(b, sizeof(b)))
+        return false;
+    *v = (Uint32)b[0] | ((Uint32)b[1] << 8) | ((Uint32)b[2] << 16) | ((Uint32)b[3] << 24);
+    return true;
+}
+
+bool replay_record_open(const char *path, unsigned int seed)
+{
+    replay_close();
+
+    file = fopen(path, "wb");
+    if (!file)
+    {
+        perror("Replay: Cannot create recording");
+        return false;
+    }
+
+    fwrite(REPLAY_MAGIC, 1, 4, file);
+    write_u16(REPLAY_VERSION);
+    write_u16(0);
+    write_u32(seed);
+    write_u32(0); // frame count, patched by replay_close
+
+    state = REPLAY_RECORDING;
+    frame_count = 0;
+    last_time = 0;
+
+    printf("Replay: Recording to %s (seed %u)\n", path, seed);
+    return true;
+}
+
+bool replay_play_open(const char *path, unsigned int *seed)
+{
+    replay_close();
+
+    file = fopen(path, "rb");
+    if (!file)
+    {
+        perror("Replay: Cannot open recording");
+        return false;
+    }
+
+    char magic[4];
+    Uint16 version = 0;
+    Uint16 reserved = 0;
+    Uint32 stored_seed = 0;
+
+    if (fread(magic, 1, 4, file) != 4 || memcmp(magic, REPLAY_MAGIC, 4) != 0 ||
+        !read_u16(&version) || !read_u16(&reserved) ||
+        !read_u32(&stored_seed) || !read_u32(&frame_count))
+    {
+        fprintf(stderr, "Replay: %s is not a recording\n", path);
+        fclose(file);
+        file = NULL;
+        return false;
+    }
+
+    if (version != REPLAY_VERSION)
+    {
+        fprintf(stderr, "Replay: %s has unsupported version %u\n", path, version);
+        fclose(file);
+        file = NULL;
+        return false;
+    }
+
+    state = REPLAY_PLAYING;
+    frames_done = 0;
+    last_time = 0;
+    if (seed)
+        *seed = stored_seed;
+
+    printf("Replay: Playing %s (%u frames, seed %u)\n", path, frame_count, stored_seed);
+    return true;
+}
+
+bool replay_is_recording(void)
+{
+    return state == REPLAY_RECORDING;
+}
+
+bool replay_is_playing(void)
+{
+    return state == REPLAY_PLAYING;
+}
+
+void replay_record_frame(const FrameInput *frame)
+{
+    if (state != REPLAY_RECORDING || !frame)
+        return;
+
+    Uint32 delta = frame->time_ms - last_time;
+    last_time = frame->time_ms;
+
+    Uint8 flags = (Uint8)(frame->direction & FLAG_DIRECTION_MASK);
+    if (frame->catch_pressed)
+        flags |= FLAG_CATCH;
+    if (frame->interact_pressed)
+        flags |= FLAG_INTERACT;
+    if (frame->reset_pressed)
+        flags |= FLAG_RESET;
+    if (frame->clicked)
+        flags |= FLAG_CLICK;
+    if (delta > 0xFF)
+        flags |= FLAG_LONG_DELTA;
+
+    fputc(flags, file);
+    if (flags & FLAG_LONG_DELTA)
+        write_u32(delta);
+    else
+        fputc((int)delta, file);
+
+    if (flags & FLAG_CLICK)
+    {
+        write_u16((Uint16)(Sint16)frame->click_x);
+        write_u16((Uint16)(Sint16)frame->click_y);
+    }
+
+    frame_count++;
+}
+
+bool replay_next_frame(FrameInput *frame)
+{
+    if (state != REPLAY_PLAYING || !frame || frames_done >= frame_count)
+        return false;
+
+    Uint8 flags;
+    Uint32 delta = 0;
+    if (!read_bytes(&flags, 1))
+        return false;
+
+    if (flags & FLAG_LONG_DELTA)
+    {
+        if (!read_u32(&delta))
+            return false;
+    }
+    else
+    {
+        Uint8 short_delta;
+        if (!read_bytes(&short_delta, 1))
+            return false;
+        delta = short_delta;
+    }
+
+    memset(frame, 0, sizeof(*frame));
+    last_time += delta;
+    frame->time_ms = last_time;
+    frame->direction = (InputDirection)(flags & FLAG_DIRECTION_MASK);
+    frame->catch_pressed = (flags & FLAG_CATCH) != 0;
+    frame->interact_pressed = (flags & FLAG_INTERACT) != 0;
+    frame->reset_pressed = (flags & FLAG_RESET) != 0;
+
+    if (flags & FLAG_CLICK)
+    {
+        Uint16 x, y;
+        if (!read_u16(&x) || !read_u16(&y))
+            return false;
+        frame->clicked = true;
+        frame->click_x = (Sint16)x;
+        frame->click_y = (Sint16)y;
+    }
+
+    frames_done++;
+    return true;
+}
+
+void replay_close(void)
+{
+    if (!file)
+    {
+        state = REPLAY_IDLE;
+        return;
+    }
+
+    if (state == REPLAY_RECORDING)
+    {
+        fseek(file, REPLAY_FRAME_COUNT_OFFSET, SEEK_SET);
+        write_u32(frame_count);
+        printf("Replay: Recorded %u frames\n", frame_count);
+    }
+
+    fclose(file);
+    file = NULL;
+    state = REPLAY_IDLE;
+}
@@ -0,0 +1,338 @@
+#include "text_cache.h"
+#include "profiler.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define TEXT_CACHE_MAX_ENTRIES 64
+
+typedef struct
+{
+    bool in_use;
+    Uint32 hash;
+
+    // cache key
+    TTF_Font *font;
+    char *text;
+    SDL_Color color;
+    int wrap_width;
+
+    // cached result
+    SDL_Texture *texture;
+    int width;
+    int height;
+    size_t bytes;
+
+    // LRU stamp, bumped on every lookup that returns this entry
+    Uint32 last_used;
+} TextCacheEntry;
+
+static SDL_Renderer *cache_renderer = NULL;
+static TextCacheEntry entries[TEXT_CACHE_MAX_ENTRIES];
+static Uint32 use_clock = 0;
+static TextCacheStats stats = {0};
+
+// Texture too large for the whole budget: handed out without an entry and
+// destroyed on the next miss, like an evicted one
+static SDL_Texture *uncached_texture = NULL;
+
+// counters for the frame in progress, published by text_cache_end_frame
+static unsigned int pending_frame_hits = 0;
+static unsigned int pending_frame_misses = 0;
+
+// FNV-1a over the text, mixed with the rest of the key
+static Uint32 hash_key(TTF_Font *font, const char *text, SDL_Color color, int wrap_width)
+{
+    Uint32 h = 2166136261u;
+
+    for (const unsigned char *p = (const unsigned char *)text; *p; p++)
+    {
+        h ^= *p;
+        h *= 16777619u;
+    }
+
+    h ^= (Uint32)(uintptr_t)font;
+    h *= 16777619u;
+    h ^= ((Uint32)color.r << 24) | ((Uint32)color.g << 16) | ((Uint32)color.b << 8) | color.a;
+    h *= 16777619u;
+    h ^= (Uint32)wrap_width;
+    h *= 16777619u;
+
+    return h;
+}
+
+static bool entry_matches(const TextCacheEntry *e, Uint32 hash, TTF_Font *font,
+                          const char *text, SDL_Color color, int wrap_width)
+{
+    return e->in_use &&
+           e->hash == hash &&
+           e->font == font &&
+           e->wrap_width == wrap_width &&
+           e->color.r == color.r && e->color.g == color.g &&
+           e->color.b == color.b && e->color.a == color.a &&
+           strcmp(e->text, text) == 0;
+}
+
+static void entry_release(TextCacheEntry *e)
+{
+    if (e->texture)
+        SDL_DestroyTexture(e->texture);
+
+    free(e->text);
+
+    stats.bytes_used -= e->bytes;
+    stats.entry_count--;
+
+    memset(e, 0, sizeof(*e));
+}
+
+// evicts the least recently used entry, returns false if the cache is empty
+static bool evict_lru(void)
+{
+    TextCacheEntry *victim = NULL;
+
+    for (int i = 0; i < TEXT_CACHE_MAX_ENTRIES; i++)
+    {
+        TextCacheEntry *e = &entries[i];
+        if (e->in_use && (!victim || e->last_used < victim->last_used))
+            victim = e;
+    }
+
+    if (!victim)
+        return false;
+
+    entry_release(victim);
+    stats.evictions++;
+    return true;
+}
+
+bool text_cache_init(SDL_Renderer *renderer, size_t byte_budget)
+{
+    if (!renderer)
+    {
+        fprintf(stderr, "TextCache: Invalid renderer\n");
+        return false;
+    }
+
+    text_cache_clear();
+
+    cache_renderer = renderer;
+    use_clock = 0;
+    pending_frame_hits = 0;
+    pending_frame_misses = 0;
+    memset(&stats, 0, sizeof(stats));
+    stats.byte_budget = byte_budget > 0 ? byte_budget : TEXT_CACHE_DEFAULT_BUDGET;
+
+    printf("TextCache: Initialized (%d entries, %zu KB budget)\n",
+           TEXT_CACHE_MAX_ENTRIES, stats.byte_budget / 1024);
+    return true;
+}
+
+static TextCacheEntry *find_entry(TTF_Font *font, const char *text, SDL_Color color,
+                                  int wrap_width)
+{
+    Uint32 hash = hash_key(font, text, color, wrap_width);
+    for (int i = 0; i < TEXT_CACHE_MAX_ENTRIES; i++)
+    {
+        if (entry_matches(&entries[i], hash, font, text, color, wrap_width))
+            return &entries[i];
+    }
+    return NULL;
+}
+
+bool text_cache_measure(TTF_Font *font, const char *text, SDL_Color color,
+                        int wrap_width, int *out_w, int *out_h)
+{
+    if (!font || !text || text[0] == '\0')
+        return false;
+
+    if (wrap_width < 0)
+        wrap_width = 0;
+
+    TextCacheEntry *e = find_entry(font, text, color, wrap_width);
+    if (e)
+    {
+        if (out_w) *out_w = e->width;
+        if (out_h) *out_h = e->height;
+        return true;
+    }
+
+    // Not rasterized yet: wrapped text is only sized by rendering it
+    if (wrap_width > 0)
+        return false;
+    return TTF_SizeUTF8(font, text, out_w, out_h) == 0;
+}
+
+SDL_Texture *text_cache_get(TTF_Font *font, const char *text, SDL_Color color,
+                            int wrap_width, int *out_w, int *out_h)
+{
+    if (!cache_renderer || !font || !text || text[0] == '\0')
+        return NULL;
+
+    if (wrap_width < 0)
+        wrap_width = 0;
+
+    Uint32 hash = hash_key(font, text, color, wrap_width);
+
+    // ---- HIT ----
+    TextCacheEntry *e = find_entry(font, text, color, wrap_width);
+    if (e)
+    {
+        e->last_used = ++use_clock;
+        stats.hits++;
+        pending_frame_hits++;
+
+        if (out_w) *out_w = e->width;
+        if (out_h) *out_h = e->height;
+        return e->texture;
+    }
+
+    // ---- MISS: rasterize once ----
+    stats.misses++;
+    pending_frame_misses++;
+
+    if (uncached_texture)
+    {
+        SDL_DestroyTexture(uncached_texture);
+        uncached_texture = NULL;
+    }
+
+    Uint64 raster_start = profiler_now();
+
+    SDL_Surface *surf = (wrap_width > 0)
+                            ? TTF_RenderUTF8_Blended_Wrapped(font, text, color, (Uint32)wrap_width)
+                            : TTF_RenderUTF8_Blended(font, text, color);
+    if (!surf)
+    {
+        fprintf(stderr, "TextCache: Failed to render '%s': %s\n", text, TTF_GetError());
+        return NULL;
+    }
+
+    SDL_Texture *tex = SDL_CreateTextureFromSurface(cache_renderer, surf);
+    int w = surf->w;
+    int h = surf->h;
+    SDL_FreeSurface(surf);
+
+    profiler_add_nested(PROFILE_TEXT, raster_start);
+
+    if (!tex)
+    {
+        fprintf(stderr, "TextCache: Failed to create texture: %s\n", SDL_GetError());
+        return NULL;
+    }
+
+    size_t bytes = (size_t)w * (size_t)h * 4;
+    if (bytes > stats.byte_budget)
+    {
+        // Caching it would evict everything and still overrun the budget
+        uncached_texture = tex;
+        stats.uncached++;
+        if (out_w) *out_w = w;
+        if (out_h) *out_h = h;
+        return tex;
+    }
+
+    size_t text_len = strlen(text);
+    char *text_copy = malloc(text_len + 1);
+    if (!text_copy)
+    {
+        SDL_DestroyTexture(tex);
+        return NULL;
+    }
+    memcpy(text_copy, text, text_len + 1);
+
+    // make room in the byte budget, then find a free slot
+    while (stats.bytes_used + bytes > stats.byte_budget && evict_lru())
+        ;
+
+    TextCacheEntry *slot = NULL;
+    for (int i = 0; i < TEXT_CACHE_MAX_ENTRIES && !slot; i++)
+    {
+        if (!entries[i].in_use)
+            slot = &entries[i];
+    }
+    if (!slot)
+    {
+        evict_lru();
+        for (int i = 0; i < TEXT_CACHE_MAX_ENTRIES && !slot; i++)
+        {
+            if (!entries[i].in_use)
+                slot = &entries[i];
+        }
+    }
+
+    slot->in_use = true;
+    slot->hash = hash;
+    slot->font = font;
+    slot->text = text_copy;
+    slot->color = color;
+    slot->wrap_width = wrap_width;
+    slot->texture = tex;
+    slot->width = w;
+    slot->height = h;
+    slot->bytes = bytes;
+    slot->last_used = ++use_clock;
+
+    stats.bytes_used += bytes;
+    stats.entry_count++;
+
+    if (out_w) *out_w = w;
+    if (out_h) *out_h = h;
+    return tex;
+}
+
+bool text_cache_draw(TTF_Font *font, const char *text, SDL_Color color,
+                     int wrap_width, int x, int y)
+{
+    int w = 0;
+    int h = 0;
+    SDL_Texture *tex = text_cache_get(font, text, color, wrap_width, &w, &h);
+    if (!tex)
+        return false;
+
+    SDL_Rect dst = {x, y, w, h};
+    SDL_RenderCopy(cache_renderer, tex, NULL, &dst);
+    return true;
+}
+
+void text_cache_end_frame(void)
+{
+    stats.frame_hits = pending_frame_hits;
+    stats.frame_misses = pending_frame_misses;
+    pending_frame_hits = 0;
+    pending_frame_misses = 0;
+}
+
+void text_cache_get_stats(TextCacheStats *out)
+{
+    if (out)
+        *out = stats;
+}
+
+void text_cache_clear(void)
+{
+    if (uncached_texture)
+    {
+        SDL_DestroyTexture(uncached_texture);
+        uncached_texture = NULL;
+    }
+
+    for (int i = 0; i < TEXT_CACHE_MAX_ENTRIES; i++)
+    {
+        if (entries[i].in_use)
+            entry_release(&entries[i]);
+    }
+}
+
+void text_cache_cleanup(void)
+{
+    if (!cache_renderer)
+        return;
+
+    printf("TextCache: %lu hits, %lu misses, %lu evictions, %lu over budget\n",
+           stats.hits, stats.misses, stats.evictions, stats.uncached);
+
+    text_cache_clear();
+    cache_renderer = NULL;
+    printf("TextCache: Cleanup complete\n");
+}
@@ -0,0 +1,44 @@
+#ifndef ASSET_LOADER_H
+#define ASSET_LOADER_H
+
+#include <SDL2/SDL.h>
+#include <stdbool.h>
+
+// Asynchronous startup loader. Worker threads read and decode files into CPU
+// memory; the main thread uploads the results between frames and hands them
+// to the regular loaders (image_load_surface / image_load_texture, audio), so
+// the code that later asks for an asset does not change.
+//
+// Usage: queue everything, asset_loader_start, call asset_loader_pump once
+// per frame until it returns true, then asset_loader_finish.
+
+// Decoded source image for image_load_surface (atlas and sprite images)
+bool asset_loader_queue_surface(const char* path);
+
+// Every PNG of a directory, as with asset_loader_queue_surface
+int asset_loader_queue_directory(const char* directory);
+
+// Image drawn at logical_w x logical_h, uploaded as the texture that
+// image_load_texture returns for the same path and size
+bool asset_loader_queue_texture(SDL_Renderer* renderer, const char* path, int logical_w, int logical_h);
+
+// Sound effect, installed with audio_set_sound (audio must be initialized)
+bool asset_loader_queue_sound(const char* path, int sound_id);
+
+// Music stream, opened into the audio music pool (audio must be initialized)
+bool asset_loader_queue_music(const char* path);
+
+// Start worker threads over the queued assets (0 picks one per spare core)
+bool asset_loader_start(int thread_count);
+
+// Main thread: upload finished assets for at most budget_ms.
+// Returns true once every queued asset has been delivered.
+bool asset_loader_pump(SDL_Renderer* renderer, Uint32 budget_ms);
+
+// Delivered and total asset counts
+void asset_loader_progress(int* done, int* total);
+
+// Deliver whatever is left, join the workers and print per-asset timings
+void asset_loader_finish(SDL_Renderer* renderer);
+
+#endif // ASSET_LOADER_H
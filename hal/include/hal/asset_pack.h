@@ -0,0 +1,53 @@
+#ifndef ASSET_PACK_H
+#define ASSET_PACK_H
+
+#include <SDL2/SDL.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+// Pack file layout (little-endian): an AssetPackHeader, entry_count index
+// entries, then the file contents in index order, which is the order the
+// game first uses them in. Every file starts on an ASSET_PACK_ALIGN boundary.
+#define ASSET_PACK_MAGIC "SFPK"
+#define ASSET_PACK_VERSION 1
+#define ASSET_PACK_PATH_MAX 120
+#define ASSET_PACK_ALIGN 16
+
+typedef struct {
+    char magic[4];
+    Uint16 version;
+    Uint16 reserved;
+    Uint32 entry_count;
+    Uint32 data_offset;        // first file byte, after the index
+} AssetPackHeader;
+
+typedef struct {
+    char path[ASSET_PACK_PATH_MAX];  // as the game asks for it, e.g. "assets/music/basement.ogg"
+    Uint32 offset;                   // from the start of the pack
+    Uint32 size;
+} AssetPackEntry;
+
+// Map a pack into memory. Assets not in the pack keep loading from loose files.
+bool asset_pack_open(const char* path);
+
+// Unmap the pack. Everything opened from it (music and fonts stream from
+// their RWops) must be closed first.
+void asset_pack_close(void);
+
+// Contents of a packed file, pointing into the mapping
+bool asset_pack_find(const char* path, const void** data, size_t* size);
+
+// Fault the pages of a packed file in on the calling thread, so that whoever
+// reads it next does not wait on the disk. False when the pack does not hold it.
+bool asset_pack_warm(const char* path);
+
+// Open an asset for reading: a zero-copy memory RWops over the pack when it
+// holds the path, the loose file otherwise. NULL if neither exists.
+// Safe to call from any thread.
+SDL_RWops* asset_open(const char* path);
+
+// Write every asset opened so far, one path per line in first-use order.
+// This is the order file the pack is built from.
+bool asset_pack_write_access_order(const char* path);
+
+#endif // ASSET_PACK_H
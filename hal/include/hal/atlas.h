@@ -0,0 +1,29 @@
+#ifndef ATLAS_H
+#define ATLAS_H
+
+#include <SDL2/SDL.h>
+#include <stdbool.h>
+
+// A packed image: a rectangle inside one of the atlas page textures.
+// Images are stored pre-scaled to the output resolution, so rect (texels)
+// can be smaller than the width x height the image is drawn at.
+typedef struct {
+    SDL_Texture* texture;
+    SDL_Rect rect;
+    int width;             // logical size of the original image
+    int height;
+} AtlasRegion;
+
+// Pack every PNG found in the given directories into as few textures as possible
+bool atlas_init(SDL_Renderer* renderer, const char* const* directories, int directory_count);
+
+// Look up the region of a packed image by the path it was loaded from
+bool atlas_find(const char* path, AtlasRegion* out);
+
+// Opaque white block, used to draw solid rectangles inside a sprite batch
+bool atlas_get_white_region(AtlasRegion* out);
+
+// Free atlas textures
+void atlas_cleanup(void);
+
+#endif // ATLAS_H
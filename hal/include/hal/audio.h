@@ -3,13 +3,40 @@
 
 #include <stdbool.h>
 
-// Initialize audio system
-bool audio_init(void);
+struct Mix_Chunk;
+
+// Adaptive mixer buffer (audio_init given 0): starts at 5.8 ms at 44.1 kHz
+// and doubles whenever underruns pile up, up to 92.9 ms
+#define AUDIO_ADAPTIVE_START_FRAMES 256
+#define AUDIO_ADAPTIVE_MAX_FRAMES 4096
+
+// Timing of the mixer callback on SDL's audio thread
+typedef struct {
+    int buffer_frames;         // current size
+    double period_ms;          // audio one buffer holds
+    unsigned long callbacks;
+    unsigned long underruns;   // estimated: a callback two periods late or mixing longer than a period
+    unsigned long late_callbacks; // more than 1.5 periods after the previous one
+    int buffer_growths;
+    double interval_total_ms;  // between the ends of two callbacks
+    double interval_max_ms;
+    double mix_total_ms;       // audio thread CPU time per callback
+    double mix_max_ms;         // period_ms - mix_max_ms is the headroom left
+} AudioStats;
+
+// Initialize audio system with a mixer buffer of buffer_frames
+// (0 = adaptive, see audio_update).
+// Playback calls below are queued to an audio command thread and return
+// without waiting for the mixer.
+bool audio_init(int buffer_frames);
+
+void audio_get_stats(AudioStats* stats);
 
 // Cleanup audio system
 void audio_cleanup(void);
 
-// Music functions
+// Music functions. Opened tracks stay in a small pool, so loading or
+// switching to one again does not touch the disk.
 bool audio_load_music(const char* filename);
 void audio_play_music(void);
 void audio_stop_music(void);
@@ -17,8 +44,23 @@ void audio_pause_music(void);
 void audio_resume_music(void);
 void audio_set_music_volume(int volume); // 0-128
 
+// Switch the playing music to filename: the current track fades out over
+// the first half of fade_ms and the new one fades in over the second half
+bool audio_crossfade_music(const char* filename, int fade_ms);
+
+// Advance a crossfade and grow an adaptive buffer; call once per frame
+void audio_update(void);
+
+// Open a music file into the pool ahead of time. Safe to call from any thread.
+bool audio_prefetch_music(const char* filename);
+
+// True when filename is in the pool
+bool audio_music_is_ready(const char* filename);
+
 // Sound effect functions
 bool audio_load_sound(const char* filename, int sound_id);
+bool audio_set_sound(int sound_id, struct Mix_Chunk* chunk); // takes ownership of an already loaded chunk
+struct Mix_Chunk* audio_read_sound(const char* filename); // decode only, from any thread
 void audio_play_sound(int sound_id);
 void audio_set_sound_volume(int sound_id, int volume); // 0-128
 
@@ -2,11 +2,36 @@
 #define BUTTON_H
 
 #include <stdbool.h>
+#include <stdint.h>
+
+typedef enum
+{
+    BUTTON_CATCH, // line 13
+    BUTTON_RESET, // line 14
+    BUTTON_COUNT
+} ButtonId;
 
 // Initialize both buttons
 void button_initialize(void);
 
-// Catch/Interact button (line 13)
+// Read the edge events the kernel queued since the last call (non-blocking)
+// and debounce them. The functions below call it themselves.
+void button_update(void);
+
+// Hand out the oldest debounced change of a button not handed out yet:
+// pressed or released, and the kernel time of its edge (CLOCK_MONOTONIC).
+// Every change is returned exactly once, however short the press was.
+bool button_take_edge(ButtonId id, bool *pressed, uint64_t *timestamp_ns);
+
+// Same queue, skipping releases: the oldest press not handed out yet.
+// timestamp_ns is optional.
+bool button_take_press(ButtonId id, uint64_t *timestamp_ns);
+
+// File descriptor that becomes readable when a button has edge events
+// (-1 without hardware)
+int button_get_fd(ButtonId id);
+
+// Catch/Interact button (line 13); wasJustPressed takes one queued press
 bool button_catch_isPressed(void);
 bool button_catch_wasJustPressed(void);
 
@@ -3,19 +3,91 @@
 
 #include <SDL2/SDL.h>
 #include <stdbool.h>
+#include <stdint.h>
+
+typedef enum {
+    DISPLAY_MODE_WINDOW,            // kmsdrm on the target, a window on a host
+    DISPLAY_MODE_HEADLESS_SOFTWARE, // offscreen software surface, no window/GPU
+    DISPLAY_MODE_HEADLESS_NULL,     // no rasterization: no regions to draw, no present
+} DisplayMode;
+
+typedef struct {
+    unsigned long frames;
+    unsigned long full_frames;       // frames repainted entirely
+    int last_rect_count;             // regions repainted in the last frame
+    long last_area;                  // logical pixels repainted in the last frame
+    unsigned long long total_area;   // logical pixels repainted since init
+    long frame_area;                 // logical pixels of a whole frame
+} DisplayRepaintStats;
+
+typedef struct {
+    unsigned long inputs;            // inputs measured since init
+    int history;                     // inputs in the percentile window
+    double p50_ms;                   // input time to present, percentiles
+    double p95_ms;
+    double p99_ms;
+    double worst_ms;                 // over the window
+} DisplayLatencyStats;
 
 // initializes the display window and renderer
 bool display_init(const char* title, int width, int height);
 
+// same as display_init, choosing between a real display and headless rendering
+bool display_init_mode(const char* title, int width, int height, DisplayMode mode);
+
+// true when rendering offscreen
+bool display_is_headless(void);
+
 // cleans up the display resources
 void display_cleanup(void);
 
 // gets the renderer for drawing operations
 SDL_Renderer* display_get_renderer(void);
 
-// clears the display
+// turns waiting for the display refresh on present on or off; false when
+// the renderer refused. Always false headless: there is no refresh to wait
+// for, so vsync stays off either way
+bool display_set_vsync(bool enabled);
+
+// refresh rate of the display in Hz (0 if unknown)
+int display_get_refresh_rate(void);
+
+// clears the display (only the region being repainted, see display_begin_frame)
 void display_clear(int r, int g, int b);
 
+// sets the size of the damage grid cells in logical pixels (e.g. one tile)
+void display_set_damage_cell(int cell_size);
+
+// marks a logical rectangle as changed since the last frame
+void display_damage_rect(const SDL_Rect* rect);
+
+// marks the whole screen as changed
+void display_damage_all(void);
+
+// binds the persistent back buffer and returns the damaged regions to
+// repaint this frame, merged into a few so that the passes stay cheap;
+// draw the scene once per region with it as clip rect. Always 0 in
+// DISPLAY_MODE_HEADLESS_NULL, where the damage only goes into the stats.
+int display_begin_frame(const SDL_Rect** regions);
+
+// reads repaint counters
+void display_get_repaint_stats(DisplayRepaintStats* stats);
+
+// binds a render target, remembering the current one with its scale and clip
+bool display_push_target(SDL_Texture* target);
+
+// restores the render target saved by display_push_target
+void display_pop_target(void);
+
+// the frame being built shows the effect of an input read at input_ns
+// (CLOCK_MONOTONIC, from the HAL device that took it); the time from then
+// until the frame is presented is logged and kept for the percentiles.
+// With several inputs in one frame the oldest one counts.
+void display_mark_input(unsigned long input_id, uint64_t input_ns);
+
+// reads input-to-present latency percentiles
+void display_get_latency_stats(DisplayLatencyStats* stats);
+
 // presents the rendered frames to the screen
 void display_present(void);
 
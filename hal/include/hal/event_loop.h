@@ -0,0 +1,49 @@
+#ifndef EVENT_LOOP_H
+#define EVENT_LOOP_H
+
+#include <stdbool.h>
+
+// Sleeping between frames without polling: waits on input file descriptors
+// (GPIO line requests, the joystick sampler, input devices), event_loop_wake
+// and a timer for the next deadline, all through one epoll set.
+//
+// SDL's event watch only runs when an event is queued, and SDL queues
+// window-system events (expose, focus, resize) only while pumping, which
+// nothing does during a wait. So the watch wakes a wait only for events
+// pushed from other threads; window-system events are picked up when the
+// wait ends at its deadline (the caller's cap, e.g. 250 ms when idle).
+
+typedef struct
+{
+    unsigned long waits;
+    unsigned long input_wakeups; // woken by a watched fd or event_loop_wake
+    unsigned long timer_wakeups; // deadline reached
+    double waited_ms;            // total time spent asleep
+} EventLoopStats;
+
+// create the epoll set and its timer
+bool event_loop_init(void);
+
+// wake up when fd becomes readable. With drain the fd is read empty after a
+// wakeup (for descriptors nobody else reads, e.g. event counters); without
+// it, its owner must read it before the next wait.
+bool event_loop_watch_fd(int fd, bool drain);
+
+// watch every /dev/input/event* device that can be opened, on a descriptor
+// of our own so SDL still reads its events; returns how many were opened
+int event_loop_watch_input_devices(void);
+
+// end a wait early; safe from any thread
+void event_loop_wake(void);
+
+// sleep until input arrives, event_loop_wake is called or the absolute
+// CLOCK_MONOTONIC deadline passes; true when woken by input
+bool event_loop_wait_until(long long deadline_ns);
+
+// read wait statistics
+void event_loop_get_stats(EventLoopStats *stats);
+
+// close every descriptor opened here and print a summary
+void event_loop_cleanup(void);
+
+#endif
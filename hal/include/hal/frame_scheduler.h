@@ -0,0 +1,54 @@
+#ifndef FRAME_SCHEDULER_H
+#define FRAME_SCHEDULER_H
+
+#include <stdbool.h>
+
+typedef enum
+{
+    FRAME_MODE_VSYNC,    // present blocks on the display refresh, no extra sleep
+    FRAME_MODE_FIXED,    // sleep to absolute deadlines at the target rate
+    FRAME_MODE_UNCAPPED, // run as fast as possible
+} FrameMode;
+
+typedef struct
+{
+    unsigned long frames;
+    unsigned long missed_frames; // deadlines (or refreshes) that were skipped
+    unsigned long idle_frames;   // ended with frame_scheduler_end_idle_frame
+    double fps;                  // achieved rate over the recent window
+    double average_ms;           // mean frame time over the recent window
+    double jitter_ms;            // standard deviation of the frame time
+    double worst_ms;             // longest frame in the recent window
+} FrameStats;
+
+// initialize the scheduler; refresh_hz is the display refresh (0 if unknown)
+bool frame_scheduler_init(FrameMode mode, int target_fps, int refresh_hz);
+
+// switch pacing mode, restarting the deadline sequence
+void frame_scheduler_set_mode(FrameMode mode);
+
+// current pacing mode
+FrameMode frame_scheduler_get_mode(void);
+
+// end of frame: sleeps until the next deadline in fixed mode and records
+// the frame time (call once per frame, after presenting)
+void frame_scheduler_end_frame(void);
+
+// end of a frame after which nothing is animating: sleeps until input
+// arrives (see event_loop.h) or max_wait_ms passes, instead of until the
+// next deadline; the frame after it starts a new deadline sequence
+void frame_scheduler_end_idle_frame(int max_wait_ms);
+
+// read pacing statistics
+void frame_scheduler_get_stats(FrameStats *stats);
+
+// parse "vsync", "fixed" or "uncapped"
+bool frame_scheduler_parse_mode(const char *name, FrameMode *mode);
+
+// printable name of a mode
+const char *frame_scheduler_mode_name(FrameMode mode);
+
+// print a summary of the run
+void frame_scheduler_cleanup(void);
+
+#endif
@@ -0,0 +1,72 @@
+#ifndef IMAGE_H
+#define IMAGE_H
+
+#include <SDL2/SDL.h>
+#include <stdbool.h>
+
+// Pixel layout of every surface handed out by this module and of the
+// texture blobs written by the asset compiler. ARGB8888 uploads without a
+// conversion on both the GLES2 and the software renderer.
+#define IMAGE_NATIVE_FORMAT SDL_PIXELFORMAT_ARGB8888
+
+// A pre-decoded texture blob lives next to its source image as <path>.tex
+#define IMAGE_BLOB_SUFFIX ".tex"
+
+// Load an image as a premultiplied IMAGE_NATIVE_FORMAT surface. A surface
+// preloaded for this path is handed out first; otherwise the pre-decoded
+// blob is used when one exists and the image is decoded as a last resort.
+SDL_Surface* image_load_surface(const char* path);
+
+// Same as image_load_surface without the preload table. Unlike the rest of
+// this module it is safe to call from any thread.
+SDL_Surface* image_read_surface(const char* path);
+
+// Decode an image file (PNG, JPG, WebP, ...) into a premultiplied surface
+SDL_Surface* image_decode_file(const char* path);
+
+// Read a texture blob written by image_write_blob
+SDL_Surface* image_load_blob(const char* path);
+
+// Write a premultiplied IMAGE_NATIVE_FORMAT surface as a texture blob
+bool image_write_blob(const char* path, SDL_Surface* surface);
+
+// Blend mode for textures made from premultiplied pixels
+SDL_BlendMode image_blend_mode(void);
+
+// Upload a surface from this module as a texture with the matching blend
+// mode. On renderers without custom blend modes the surface is converted
+// back to straight alpha in place first.
+SDL_Texture* image_create_texture(SDL_Renderer* renderer, SDL_Surface* surface);
+
+// Resample a surface to w x h (downscaling only: 2x box filter steps, then
+// a linear stretch for the remainder). Returns a new surface.
+SDL_Surface* image_scale_surface(SDL_Surface* source, int w, int h);
+
+// Size in physical pixels of something drawn at logical_w x logical_h
+void image_output_size(SDL_Renderer* renderer, int logical_w, int logical_h, int* out_w, int* out_h);
+
+// Downscale a surface drawn at logical_w x logical_h to the pixels it covers
+// on the output. Takes ownership of surface and returns the one to use.
+SDL_Surface* image_fit_output(SDL_Renderer* renderer, SDL_Surface* surface, int logical_w, int logical_h);
+
+// Same as image_fit_output for a target size already in output pixels
+SDL_Surface* image_fit_size(SDL_Surface* surface, int w, int h);
+
+// Load an image that is drawn at logical_w x logical_h, pre-scaled to the
+// pixels it actually covers on the output
+SDL_Surface* image_load_for_output(SDL_Renderer* renderer, const char* path, int logical_w, int logical_h);
+
+// Same as image_load_for_output, uploaded as a texture. A texture preloaded
+// for this path and logical size is handed out instead when there is one.
+SDL_Texture* image_load_texture(SDL_Renderer* renderer, const char* path, int logical_w, int logical_h);
+
+// Hand a decoded surface / an uploaded texture over to the next
+// image_load_surface / image_load_texture of the same path (and size).
+// Ownership moves to the table, then to whoever loads it.
+bool image_preload_surface(const char* path, SDL_Surface* surface);
+bool image_preload_texture(const char* path, int logical_w, int logical_h, SDL_Texture* texture);
+
+// Free preloaded images nobody asked for
+void image_preload_clear(void);
+
+#endif // IMAGE_H
@@ -1,6 +1,7 @@
 #ifndef JOYSTICK_H
 #define JOYSTICK_H
 #include <stdbool.h>
+#include <stdint.h>
 
 typedef enum
 {
@@ -11,13 +12,57 @@ typedef enum
     joy_right, // 4
 } joystickDirection;
 
-// initialize joystick with SPI set up and calibration
-bool joystick_initialize(void);
+// default rate of the sampler thread
+#define JOYSTICK_DEFAULT_RATE_HZ 500
 
-// clean up joystick data at exit
+// rate while the stick rests and the game sleeps on input
+#define JOYSTICK_IDLE_RATE_HZ 100
+
+// latest filtered joystick state
+typedef struct
+{
+    int x; // 12-bit, averaged
+    int y;
+    joystickDirection direction;
+    unsigned long samples; // taken since initialization
+    uint64_t timestamp_ns; // CLOCK_MONOTONIC time the latest sample was read
+
+    // sample that last changed the direction, and when it was read
+    unsigned long changed_sample;
+    uint64_t changed_ns;
+} JoystickState;
+
+// one change of the filtered direction
+typedef struct
+{
+    joystickDirection direction; // the new direction
+    unsigned long sample;
+    uint64_t timestamp_ns;       // CLOCK_MONOTONIC time the sample was read
+} JoystickChange;
+
+// initialize joystick with SPI set up and start a thread sampling it at
+// sample_rate_hz (0 = JOYSTICK_DEFAULT_RATE_HZ)
+bool joystick_initialize(int sample_rate_hz);
+
+// change the sampler rate (0 = the rate given to joystick_initialize); the
+// new period starts after the sample in progress
+void joystick_set_rate(int sample_rate_hz);
+
+// stop sampling and clean up joystick data at exit
 void joystick_cleanup(void);
 
-// get the direction of the joysticks position
+// copy the latest filtered state, without touching the SPI bus
+bool joystick_read(JoystickState *state);
+
+// hand out the oldest direction change not handed out yet, so a flick
+// between two reads is not lost (single reader)
+bool joystick_take_change(JoystickChange *change);
+
+// counter file descriptor that becomes readable whenever the filtered
+// direction changes (-1 when unavailable); the reader drains it
+int joystick_get_fd(void);
+
+// get the direction of the joysticks position (latest filtered state)
 joystickDirection joystick_getDirection(void);
 
 #endif
\ No newline at end of file
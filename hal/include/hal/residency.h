@@ -0,0 +1,72 @@
+#ifndef RESIDENCY_H
+#define RESIDENCY_H
+
+#include <SDL2/SDL.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+// Texture residency: reloadable image textures are registered by path and
+// only kept on the GPU while the byte budget allows. The least recently used
+// ones are evicted and loaded again on their next use. Other textures (atlas
+// pages, render targets) can be tracked so that the totals cover them too,
+// but are never evicted.
+
+typedef int ResidentTexture;
+#define RESIDENT_NONE (-1)
+
+// Default budget for reloadable textures (6 MB: four full-window images at
+// the panel resolution)
+#define RESIDENCY_DEFAULT_BUDGET (6u * 1024u * 1024u)
+
+typedef struct {
+    size_t budget_bytes;
+    size_t resident_bytes;     // reloadable textures currently loaded
+    size_t tracked_bytes;      // other tracked textures
+    size_t peak_bytes;         // highest resident + tracked so far
+    int resident_count;
+    int registered_count;
+    unsigned long loads;       // including reloads after an eviction
+    unsigned long evictions;
+} ResidencyStats;
+
+// Set the renderer textures are loaded for and the budget (0 = default)
+bool residency_init(SDL_Renderer* renderer, size_t budget_bytes);
+
+// Handle for an image drawn at logical_w x logical_h. Registering the same
+// path and size again returns the same handle. Nothing is loaded yet.
+ResidentTexture residency_register(const char* path, int logical_w, int logical_h);
+
+// The texture for a handle, loaded now if it is not resident. Textures used
+// in the current frame are never evicted, so the result stays valid until
+// the next residency_begin_frame.
+SDL_Texture* residency_acquire(ResidentTexture handle);
+
+// Make a texture loaded elsewhere (e.g. decoded ahead of time) resident for
+// a handle. Takes ownership; it is destroyed if the handle is resident already.
+bool residency_adopt(ResidentTexture handle, SDL_Texture* texture);
+
+// True while the texture for a handle is loaded
+bool residency_is_resident(ResidentTexture handle);
+
+// Path and logical size a handle was registered with, NULL for a bad handle
+const char* residency_get_source(ResidentTexture handle, int* logical_w, int* logical_h);
+
+// Drop a texture right away (it is reloaded on its next acquire)
+void residency_evict(ResidentTexture handle);
+
+// Start a new frame: textures acquired before become evictable
+void residency_begin_frame(void);
+
+// Count a texture the manager does not own / stop counting it
+void residency_track(SDL_Texture* texture);
+void residency_untrack(SDL_Texture* texture);
+
+// Bytes a texture occupies
+size_t residency_texture_bytes(SDL_Texture* texture);
+
+void residency_get_stats(ResidencyStats* stats);
+
+// Free every reloadable texture and print the totals
+void residency_cleanup(void);
+
+#endif // RESIDENCY_H
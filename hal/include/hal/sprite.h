@@ -4,13 +4,20 @@
 #include <SDL2/SDL.h>
 #include <stdbool.h>
 
+// A sprite is a region of a texture: either a region of the shared
+// sprite atlas, or a whole texture of its own
 typedef struct {
     SDL_Texture* texture;
+    SDL_Rect src;          // region inside texture
     int width;
     int height;
+    int cache_ref;         // sprite cache entry + 1 (0: no reference, so a
+                           // zero-initialized sprite is safe to free)
 } Sprite;
 
-// Load a sprite from a PNG file
+// Load a sprite from a PNG file (uses the atlas region when it was packed).
+// Sprites loaded from the same path share one cached, reference-counted
+// texture, so only the first load touches the disk.
 bool sprite_load(Sprite* sprite, SDL_Renderer* renderer, const char* filename);
 
 // Render sprite at position (x, y)
@@ -22,7 +29,15 @@ void sprite_render_scaled(Sprite* sprite, SDL_Renderer* renderer, int x, int y,
 // Render a portion of the sprite (for sprite sheets)
 void sprite_render_clip(Sprite* sprite, SDL_Renderer* renderer, int x, int y, SDL_Rect* clip);
 
-// Free sprite resources
+// Release the sprite's reference (the texture is freed with the last one)
 void sprite_free(Sprite* sprite);
 
-#endif // SPRITE_H
\ No newline at end of file
+// Sprite batching: draws between begin/end are queued as vertices and
+// submitted with one SDL_RenderGeometry call per texture run.
+// Outside a begin/end pair the draw functions render immediately.
+void sprite_batch_begin(SDL_Renderer* renderer);
+void sprite_batch_draw(Sprite* sprite, SDL_Renderer* renderer, int x, int y);
+void sprite_batch_fill_rect(SDL_Renderer* renderer, const SDL_Rect* rect, SDL_Color color);
+void sprite_batch_end(void);
+
+#endif // SPRITE_H
@@ -0,0 +1,324 @@
+#include "asset_loader.h"
+#include "asset_pack.h"
+#include "audio.h"
+#include "image.h"
+#include <SDL2/SDL_image.h>
+#include <SDL2/SDL_mixer.h>
+#include <dirent.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <string.h>
+
+#define LOADER_MAX_JOBS 64
+#define LOADER_MAX_THREADS 4
+#define LOADER_PATH_MAX 128
+
+typedef enum {
+    JOB_SURFACE,
+    JOB_TEXTURE,
+    JOB_SOUND,
+    JOB_MUSIC
+} JobKind;
+
+typedef enum {
+    JOB_QUEUED,
+    JOB_RUNNING,               // a worker is decoding it
+    JOB_DECODED,               // waiting for the main thread
+    JOB_DELIVERED
+} JobState;
+
+typedef struct {
+    JobKind kind;
+    char path[LOADER_PATH_MAX];
+    int logical_w;             // JOB_TEXTURE: size the image is drawn at
+    int logical_h;
+    int output_w;              // and the pixels that covers on the output
+    int output_h;
+    int sound_id;              // JOB_SOUND
+
+    JobState state;            // guarded by lock
+    SDL_Surface* surface;      // worker results, read once state is JOB_DECODED
+    Mix_Chunk* chunk;
+    bool ok;                   // JOB_MUSIC: set by the worker
+
+    double decode_ms;          // worker: read + decode (+ downscale)
+    double upload_ms;          // main thread: texture upload / hand-over
+} LoaderJob;
+
+static LoaderJob jobs[LOADER_MAX_JOBS];
+static int job_count = 0;
+static int next_job = 0;       // guarded by lock
+static int delivered = 0;
+
+static pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_t threads[LOADER_MAX_THREADS];
+static int thread_count = 0;
+static Uint64 start_counter = 0;
+
+static double elapsed_ms(Uint64 since) {
+    return (double)(SDL_GetPerformanceCounter() - since) * 1000.0 /
+           (double)SDL_GetPerformanceFrequency();
+}
+
+static LoaderJob* add_job(JobKind kind, const char* path) {
+    if (thread_count > 0) {
+        fprintf(stderr, "Loader: Cannot queue '%s' while loading\n", path);
+        return NULL;
+    }
+    if (job_count >= LOADER_MAX_JOBS) {
+        fprintf(stderr, "Loader: Queue full, skipping '%s'\n", path);
+        return NULL;
+    }
+
+    LoaderJob* job = &jobs[job_count++];
+    memset(job, 0, sizeof(*job));
+    job->kind = kind;
+    job->state = JOB_QUEUED;
+    snprintf(job->path, sizeof(job->path), "%s", path);
+    return job;
+}
+
+bool asset_loader_queue_surface(const char* path) {
+    return add_job(JOB_SURFACE, path) != NULL;
+}
+
+int asset_loader_queue_directory(const char* directory) {
+    DIR* dir = opendir(directory);
+    if (!dir) {
+        fprintf(stderr, "Loader: Cannot open '%s'\n", directory);
+        return 0;
+    }
+
+    int queued = 0;
+    struct dirent* ent;
+    while ((ent = readdir(dir)) != NULL) {
+        size_t len = strlen(ent->d_name);
+        if (len <= 4 || strcmp(ent->d_name + len - 4, ".png") != 0) {
+            continue;
+        }
+
+        char path[LOADER_PATH_MAX];
+        snprintf(path, sizeof(path), "%s/%s", directory, ent->d_name);
+        if (asset_loader_queue_surface(path)) {
+            queued++;
+        }
+    }
+
+    closedir(dir);
+    return queued;
+}
+
+bool asset_loader_queue_texture(SDL_Renderer* renderer, const char* path, int logical_w, int logical_h) {
+    LoaderJob* job = add_job(JOB_TEXTURE, path);
+    if (!job) {
+        return false;
+    }
+
+    // The renderer is only touched here, on the main thread
+    job->logical_w = logical_w;
+    job->logical_h = logical_h;
+    image_output_size(renderer, logical_w, logical_h, &job->output_w, &job->output_h);
+    return true;
+}
+
+bool asset_loader_queue_sound(const char* path, int sound_id) {
+    LoaderJob* job = add_job(JOB_SOUND, path);
+    if (!job) {
+        return false;
+    }
+    job->sound_id = sound_id;
+    return true;
+}
+
+bool asset_loader_queue_music(const char* path) {
+    return add_job(JOB_MUSIC, path) != NULL;
+}
+
+static void* worker_main(void* arg) {
+    (void)arg;
+
+    for (;;) {
+        pthread_mutex_lock(&lock);
+        int index = next_job < job_count ? next_job++ : -1;
+        if (index >= 0) {
+            jobs[index].state = JOB_RUNNING;
+        }
+        pthread_mutex_unlock(&lock);
+
+        if (index < 0) {
+            return NULL;
+        }
+
+        LoaderJob* job = &jobs[index];
+        Uint64 start = SDL_GetPerformanceCounter();
+
+        switch (job->kind) {
+        case JOB_SURFACE:
+            job->surface = image_read_surface(job->path);
+            break;
+        case JOB_TEXTURE:
+            job->surface = image_fit_size(image_read_surface(job->path), job->output_w, job->output_h);
+            break;
+        case JOB_SOUND:
+            // Through audio.c, which keeps it clear of a mixer reopen
+            job->chunk = audio_read_sound(job->path);
+            break;
+        case JOB_MUSIC:
+            job->ok = audio_prefetch_music(job->path);
+            break;
+        }
+
+        job->decode_ms = elapsed_ms(start);
+
+        pthread_mutex_lock(&lock);
+        job->state = JOB_DECODED;
+        pthread_mutex_unlock(&lock);
+    }
+}
+
+bool asset_loader_start(int requested_threads) {
+    if (thread_count > 0) {
+        return true;
+    }
+
+    // Decoder plugins are initialized lazily by IMG_Load, which is not
+    // thread-safe: bring them all up before the workers race for them
+    IMG_Init(IMG_INIT_PNG | IMG_INIT_JPG | IMG_INIT_WEBP);
+
+    int wanted = requested_threads > 0 ? requested_threads : SDL_GetCPUCount() - 1;
+    if (wanted < 1) wanted = 1;
+    if (wanted > LOADER_MAX_THREADS) wanted = LOADER_MAX_THREADS;
+    if (wanted > job_count) wanted = job_count;
+
+    next_job = 0;
+    delivered = 0;
+    start_counter = SDL_GetPerformanceCounter();
+
+    for (int i = 0; i < wanted; i++) {
+        if (pthread_create(&threads[thread_count], NULL, worker_main, NULL) != 0) {
+            fprintf(stderr, "Loader: Failed to start worker %d\n", i);
+            break;
+        }
+        thread_count++;
+    }
+
+    printf("Loader: %d assets on %d threads\n", job_count, thread_count);
+    return thread_count > 0 || job_count == 0;
+}
+
+// main thread: turns a decoded job into the asset its consumer will ask for
+static void deliver(SDL_Renderer* renderer, LoaderJob* job) {
+    Uint64 start = SDL_GetPerformanceCounter();
+
+    switch (job->kind) {
+    case JOB_SURFACE:
+        job->ok = job->surface && image_preload_surface(job->path, job->surface);
+        if (!job->ok) {
+            SDL_FreeSurface(job->surface);
+        }
+        break;
+    case JOB_TEXTURE:
+        if (job->surface) {
+            SDL_Texture* texture = image_create_texture(renderer, job->surface);
+            job->ok = texture && image_preload_texture(job->path, job->logical_w, job->logical_h, texture);
+            if (texture && !job->ok) {
+                SDL_DestroyTexture(texture);
+            }
+            SDL_FreeSurface(job->surface);
+        }
+        break;
+    case JOB_SOUND:
+        job->ok = job->chunk && audio_set_sound(job->sound_id, job->chunk);
+        break;
+    case JOB_MUSIC:
+        break;
+    }
+
+    job->surface = NULL;
+    job->chunk = NULL;
+    job->upload_ms = elapsed_ms(start);
+
+    pthread_mutex_lock(&lock);
+    job->state = JOB_DELIVERED;
+    pthread_mutex_unlock(&lock);
+    delivered++;
+}
+
+bool asset_loader_pump(SDL_Renderer* renderer, Uint32 budget_ms) {
+    Uint64 start = SDL_GetPerformanceCounter();
+
+    for (int i = 0; i < job_count; i++) {
+        pthread_mutex_lock(&lock);
+        JobState state = jobs[i].state;
+        pthread_mutex_unlock(&lock);
+
+        if (state != JOB_DECODED) {
+            continue;
+        }
+
+        deliver(renderer, &jobs[i]);
+        if (elapsed_ms(start) >= budget_ms) {
+            break;
+        }
+    }
+
+    return delivered == job_count;
+}
+
+void asset_loader_progress(int* done, int* total) {
+    if (done) *done = delivered;
+    if (total) *total = job_count;
+}
+
+static const char* kind_name(JobKind kind) {
+    switch (kind) {
+    case JOB_SURFACE: return "image";
+    case JOB_TEXTURE: return "texture";
+    case JOB_SOUND:   return "sound";
+    case JOB_MUSIC:   return "music";
+    }
+    return "?";
+}
+
+void asset_loader_finish(SDL_Renderer* renderer) {
+    // Without workers the queue is drained right here
+    if (thread_count == 0) {
+        if (start_counter == 0) {
+            start_counter = SDL_GetPerformanceCounter();
+        }
+        worker_main(NULL);
+    }
+
+    while (!asset_loader_pump(renderer, UINT32_MAX)) {
+        SDL_Delay(1);
+    }
+
+    for (int i = 0; i < thread_count; i++) {
+        pthread_join(threads[i], NULL);
+    }
+
+    double wall_ms = elapsed_ms(start_counter);
+    double decode_total = 0.0;
+    double upload_total = 0.0;
+    int failed = 0;
+
+    printf("Loader:  decode   upload  asset\n");
+    for (int i = 0; i < job_count; i++) {
+        LoaderJob* job = &jobs[i];
+        printf("Loader: %6.1f ms %5.1f ms  %s (%s)%s\n", job->decode_ms, job->upload_ms,
+               job->path, kind_name(job->kind), job->ok ? "" : " FAILED");
+        decode_total += job->decode_ms;
+        upload_total += job->upload_ms;
+        if (!job->ok) {
+            failed++;
+        }
+    }
+    printf("Loader: %d assets (%d failed) in %.1f ms wall, %.1f ms decode, %.1f ms upload\n",
+           job_count, failed, wall_ms, decode_total, upload_total);
+
+    job_count = 0;
+    next_job = 0;
+    delivered = 0;
+    thread_count = 0;
+    start_counter = 0;
+}
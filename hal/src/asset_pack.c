@@ -0,0 +1,179 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include "asset_pack.h"
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define ACCESS_LOG_MAX 256
+
+static const Uint8* pack_data = NULL;
+static size_t pack_size = 0;
+static const AssetPackEntry* pack_index = NULL;
+static Uint32 pack_entry_count = 0;
+
+// First-use order of every asset opened, for rebuilding the pack order
+static pthread_mutex_t access_lock = PTHREAD_MUTEX_INITIALIZER;
+static char access_log[ACCESS_LOG_MAX][ASSET_PACK_PATH_MAX];
+static int access_count = 0;
+
+static void record_access(const char* path) {
+    pthread_mutex_lock(&access_lock);
+
+    bool seen = false;
+    for (int i = 0; i < access_count && !seen; i++) {
+        seen = strcmp(access_log[i], path) == 0;
+    }
+    if (!seen && access_count < ACCESS_LOG_MAX) {
+        snprintf(access_log[access_count++], ASSET_PACK_PATH_MAX, "%s", path);
+    }
+
+    pthread_mutex_unlock(&access_lock);
+}
+
+bool asset_pack_open(const char* path) {
+    asset_pack_close();
+
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        printf("Pack: No pack at '%s', using loose files\n", path);
+        return false;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(AssetPackHeader)) {
+        fprintf(stderr, "Pack: '%s' is too small\n", path);
+        close(fd);
+        return false;
+    }
+
+    // Private so that the mapping can back read-only views of the files;
+    // the descriptor is not needed once it is mapped
+    void* data = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED) {
+        fprintf(stderr, "Pack: Failed to map '%s'\n", path);
+        return false;
+    }
+
+    const AssetPackHeader* header = data;
+    Uint32 count = SDL_SwapLE32(header->entry_count);
+    size_t index_end = sizeof(AssetPackHeader) + (size_t)count * sizeof(AssetPackEntry);
+
+    if (memcmp(header->magic, ASSET_PACK_MAGIC, 4) != 0 ||
+        SDL_SwapLE16(header->version) != ASSET_PACK_VERSION ||
+        index_end > (size_t)st.st_size) {
+        fprintf(stderr, "Pack: '%s' is not an asset pack\n", path);
+        munmap(data, (size_t)st.st_size);
+        return false;
+    }
+
+    const AssetPackEntry* index = (const AssetPackEntry*)(header + 1);
+    for (Uint32 i = 0; i < count; i++) {
+        Uint64 end = (Uint64)SDL_SwapLE32(index[i].offset) + SDL_SwapLE32(index[i].size);
+        if (end > (Uint64)st.st_size || index[i].path[ASSET_PACK_PATH_MAX - 1] != '\0') {
+            fprintf(stderr, "Pack: '%s' has a corrupt index\n", path);
+            munmap(data, (size_t)st.st_size);
+            return false;
+        }
+    }
+
+    // Files are laid out in first-use order, so read-ahead pays off
+    posix_madvise(data, (size_t)st.st_size, POSIX_MADV_SEQUENTIAL);
+
+    pack_data = data;
+    pack_size = (size_t)st.st_size;
+    pack_index = index;
+    pack_entry_count = count;
+
+    printf("Pack: Mapped '%s' (%u assets, %zu KB)\n", path, count, pack_size / 1024);
+    return true;
+}
+
+void asset_pack_close(void) {
+    if (pack_data) {
+        munmap((void*)pack_data, pack_size);
+    }
+    pack_data = NULL;
+    pack_size = 0;
+    pack_index = NULL;
+    pack_entry_count = 0;
+}
+
+bool asset_pack_find(const char* path, const void** data, size_t* size) {
+    if (!pack_data || !path) {
+        return false;
+    }
+
+    // A few dozen entries: a linear scan is cheaper than anything cleverer
+    for (Uint32 i = 0; i < pack_entry_count; i++) {
+        if (strcmp(pack_index[i].path, path) == 0) {
+            if (data) *data = pack_data + SDL_SwapLE32(pack_index[i].offset);
+            if (size) *size = SDL_SwapLE32(pack_index[i].size);
+            return true;
+        }
+    }
+    return false;
+}
+
+bool asset_pack_warm(const char* path) {
+    const void* data;
+    size_t size;
+    if (!asset_pack_find(path, &data, &size) || size == 0) {
+        return false;
+    }
+
+    // Start read-ahead for the whole range, then fault every page in here
+    size_t page = (size_t)sysconf(_SC_PAGESIZE);
+    uintptr_t start = (uintptr_t)data & ~(uintptr_t)(page - 1);
+    posix_madvise((void*)start, (uintptr_t)data + size - start, POSIX_MADV_WILLNEED);
+
+    const volatile Uint8* bytes = data;
+    Uint8 sum = 0;
+    for (size_t i = 0; i < size; i += page) {
+        sum += bytes[i];
+    }
+    sum += bytes[size - 1];
+    (void)sum;
+    return true;
+}
+
+SDL_RWops* asset_open(const char* path) {
+    if (!path) {
+        return NULL;
+    }
+
+    const void* data;
+    size_t size;
+    SDL_RWops* rw = asset_pack_find(path, &data, &size)
+                        ? SDL_RWFromConstMem(data, (int)size)
+                        : SDL_RWFromFile(path, "rb");
+    if (rw) {
+        record_access(path);
+    }
+    return rw;
+}
+
+bool asset_pack_write_access_order(const char* path) {
+    FILE* file = fopen(path, "w");
+    if (!file) {
+        fprintf(stderr, "Pack: Cannot write '%s'\n", path);
+        return false;
+    }
+
+    pthread_mutex_lock(&access_lock);
+    for (int i = 0; i < access_count; i++) {
+        fprintf(file, "%s\n", access_log[i]);
+    }
+    int count = access_count;
+    pthread_mutex_unlock(&access_lock);
+
+    fclose(file);
+    printf("Pack: Wrote first-use order of %d assets to '%s'\n", count, path);
+    return true;
+}
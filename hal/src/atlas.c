@@ -0,0 +1,255 @@
+#include "atlas.h"
+#include "image.h"
+#include "residency.h"
+#include <dirent.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define ATLAS_MAX_PAGES 4
+#define ATLAS_MAX_REGIONS 64
+#define ATLAS_MAX_PAGE_SIZE 2048
+#define ATLAS_PADDING 2        // transparent gutter against linear-filter bleeding
+#define ATLAS_WHITE_SIZE 4
+#define ATLAS_PATH_MAX 128
+
+typedef struct {
+    char path[ATLAS_PATH_MAX];
+    SDL_Surface* surface;      // only held while packing
+    int page;
+    SDL_Rect rect;             // texels inside the page
+    int width;                 // logical size the image is drawn at
+    int height;
+} AtlasEntry;
+
+static SDL_Texture* pages[ATLAS_MAX_PAGES] = {NULL};
+static int page_count = 0;
+static AtlasEntry entries[ATLAS_MAX_REGIONS];
+static int entry_count = 0;
+static SDL_Rect white_rect = {0, 0, 0, 0};
+
+static bool has_png_extension(const char* name) {
+    size_t len = strlen(name);
+    return len > 4 && strcmp(name + len - 4, ".png") == 0;
+}
+
+// loads every PNG of a directory into the entry table, pre-scaled to the
+// pixels each image covers on the output
+static void collect_directory(SDL_Renderer* renderer, const char* directory) {
+    DIR* dir = opendir(directory);
+    if (!dir) {
+        fprintf(stderr, "Atlas: Cannot open '%s'\n", directory);
+        return;
+    }
+
+    struct dirent* ent;
+    while ((ent = readdir(dir)) != NULL) {
+        if (!has_png_extension(ent->d_name)) {
+            continue;
+        }
+        if (entry_count >= ATLAS_MAX_REGIONS) {
+            fprintf(stderr, "Atlas: Too many images, skipping '%s'\n", ent->d_name);
+            continue;
+        }
+
+        AtlasEntry* e = &entries[entry_count];
+        snprintf(e->path, sizeof(e->path), "%s/%s", directory, ent->d_name);
+
+        SDL_Surface* loaded = image_load_surface(e->path);
+        if (!loaded) {
+            continue;
+        }
+
+        e->width = loaded->w;
+        e->height = loaded->h;
+        e->surface = image_fit_output(renderer, loaded, loaded->w, loaded->h);
+
+        SDL_SetSurfaceBlendMode(e->surface, SDL_BLENDMODE_NONE);
+        entry_count++;
+    }
+
+    closedir(dir);
+}
+
+static int compare_height_desc(const void* a, const void* b) {
+    const AtlasEntry* ea = *(const AtlasEntry* const*)a;
+    const AtlasEntry* eb = *(const AtlasEntry* const*)b;
+    return eb->surface->h - ea->surface->h;
+}
+
+// shelf packer: fills rows left to right, tallest images first
+static void pack_entries(int page_size, int* page_heights) {
+    AtlasEntry* order[ATLAS_MAX_REGIONS];
+    for (int i = 0; i < entry_count; i++) {
+        order[i] = &entries[i];
+    }
+    qsort(order, entry_count, sizeof(order[0]), compare_height_desc);
+
+    // the white block goes first on page 0
+    int page = 0;
+    int x = ATLAS_PADDING + ATLAS_WHITE_SIZE + ATLAS_PADDING;
+    int y = ATLAS_PADDING;
+    int shelf_h = ATLAS_WHITE_SIZE;
+    white_rect = (SDL_Rect){ATLAS_PADDING, ATLAS_PADDING, ATLAS_WHITE_SIZE, ATLAS_WHITE_SIZE};
+    page_heights[0] = y + shelf_h + ATLAS_PADDING;
+
+    for (int i = 0; i < entry_count; i++) {
+        AtlasEntry* e = order[i];
+        int w = e->surface->w;
+        int h = e->surface->h;
+
+        if (w + 2 * ATLAS_PADDING > page_size || h + 2 * ATLAS_PADDING > page_size) {
+            fprintf(stderr, "Atlas: '%s' (%dx%d) is larger than a page\n", e->path, w, h);
+            e->page = -1;
+            continue;
+        }
+
+        if (x + w + ATLAS_PADDING > page_size) {
+            // next shelf
+            y += shelf_h + ATLAS_PADDING;
+            x = ATLAS_PADDING;
+            shelf_h = 0;
+        }
+        if (y + h + ATLAS_PADDING > page_size) {
+            // next page
+            if (page + 1 >= ATLAS_MAX_PAGES) {
+                fprintf(stderr, "Atlas: Out of pages, skipping '%s'\n", e->path);
+                e->page = -1;
+                continue;
+            }
+            page++;
+            x = ATLAS_PADDING;
+            y = ATLAS_PADDING;
+            shelf_h = 0;
+        }
+
+        e->page = page;
+        e->rect = (SDL_Rect){x, y, w, h};
+
+        x += w + ATLAS_PADDING;
+        if (h > shelf_h) {
+            shelf_h = h;
+        }
+        page_heights[page] = y + shelf_h + ATLAS_PADDING;
+    }
+
+    page_count = page + 1;
+}
+
+bool atlas_init(SDL_Renderer* renderer, const char* const* directories, int directory_count) {
+    if (!renderer || !directories) {
+        fprintf(stderr, "Atlas: Invalid parameters\n");
+        return false;
+    }
+
+    atlas_cleanup();
+
+    for (int i = 0; i < directory_count; i++) {
+        collect_directory(renderer, directories[i]);
+    }
+
+    // Page size limited by what the GPU accepts
+    int page_size = ATLAS_MAX_PAGE_SIZE;
+    SDL_RendererInfo info;
+    if (SDL_GetRendererInfo(renderer, &info) == 0 && info.max_texture_width > 0) {
+        if (info.max_texture_width < page_size) page_size = info.max_texture_width;
+        if (info.max_texture_height < page_size) page_size = info.max_texture_height;
+    }
+
+    int page_heights[ATLAS_MAX_PAGES] = {0};
+    pack_entries(page_size, page_heights);
+
+    // Blit every image into its page and upload each page once
+    for (int p = 0; p < page_count; p++) {
+        SDL_Surface* page = SDL_CreateRGBSurfaceWithFormat(0, page_size, page_heights[p],
+                                                           32, IMAGE_NATIVE_FORMAT);
+        if (!page) {
+            fprintf(stderr, "Atlas: Failed to create page: %s\n", SDL_GetError());
+            continue;
+        }
+        SDL_FillRect(page, NULL, 0);
+
+        if (p == 0) {
+            SDL_FillRect(page, &white_rect, 0xFFFFFFFF);
+        }
+
+        int packed = 0;
+        for (int i = 0; i < entry_count; i++) {
+            AtlasEntry* e = &entries[i];
+            if (e->page == p) {
+                SDL_Rect dst = e->rect;
+                SDL_BlitSurface(e->surface, NULL, page, &dst);
+                packed++;
+            }
+        }
+
+        pages[p] = image_create_texture(renderer, page);
+        SDL_FreeSurface(page);
+
+        if (!pages[p]) {
+            fprintf(stderr, "Atlas: Failed to create page texture: %s\n", SDL_GetError());
+            continue;
+        }
+        residency_track(pages[p]);
+
+        printf("Atlas: Page %d is %dx%d with %d images\n", p, page_size, page_heights[p], packed);
+    }
+
+    // Surfaces are no longer needed once the pages are on the GPU
+    for (int i = 0; i < entry_count; i++) {
+        SDL_FreeSurface(entries[i].surface);
+        entries[i].surface = NULL;
+    }
+
+    return page_count > 0 && pages[0] != NULL;
+}
+
+bool atlas_find(const char* path, AtlasRegion* out) {
+    if (!path) {
+        return false;
+    }
+
+    for (int i = 0; i < entry_count; i++) {
+        AtlasEntry* e = &entries[i];
+        if (e->page >= 0 && pages[e->page] && strcmp(e->path, path) == 0) {
+            if (out) {
+                out->texture = pages[e->page];
+                out->rect = e->rect;
+                out->width = e->width;
+                out->height = e->height;
+            }
+            return true;
+        }
+    }
+    return false;
+}
+
+bool atlas_get_white_region(AtlasRegion* out) {
+    if (page_count == 0 || !pages[0]) {
+        return false;
+    }
+    if (out) {
+        out->texture = pages[0];
+        out->rect = white_rect;
+        out->width = white_rect.w;
+        out->height = white_rect.h;
+    }
+    return true;
+}
+
+void atlas_cleanup(void) {
+    for (int p = 0; p < ATLAS_MAX_PAGES; p++) {
+        if (pages[p]) {
+            residency_untrack(pages[p]);
+            SDL_DestroyTexture(pages[p]);
+            pages[p] = NULL;
+        }
+    }
+    for (int i = 0; i < entry_count; i++) {
+        if (entries[i].surface) {
+            SDL_FreeSurface(entries[i].surface);
+        }
+    }
+    page_count = 0;
+    entry_count = 0;
+}
@@ -1,14 +1,449 @@
+#define _POSIX_C_SOURCE 200809L
+
 #include "audio.h"
+#include "asset_pack.h"
 #include <SDL2/SDL.h> 
 #include <SDL2/SDL_mixer.h>
+#include <pthread.h>
+#include <semaphore.h>
+#include <stdatomic.h>
 #include <stdio.h>
+#include <string.h>
+#include <time.h>
 
 #define MAX_SOUNDS 32
+#define AUDIO_RATE 44100
+#define COMMAND_RING_SIZE 64       // power of two
+
+// Callbacks right after the device opens come irregularly; not counted
+#define AUDIO_WARMUP_CALLBACKS 8
+
+// Adaptive buffer: doubled when this many underruns happen within the window
+#define AUDIO_UNDERRUN_THRESHOLD 3
+#define AUDIO_UNDERRUN_WINDOW_MS 10000
+#define MUSIC_POOL_SIZE 4
+#define MUSIC_PATH_MAX 128
+
+typedef struct {
+    char path[MUSIC_PATH_MAX];
+    Mix_Music* music;          // NULL for a free slot
+    Uint32 last_used;
+} PooledMusic;
+
+// Opened music streams, kept so that switching tracks never goes back to
+// the disk. Guarded by pool_lock: audio_prefetch_music may add to the pool
+// from any thread. Playback itself runs on the command thread (see below).
+static pthread_mutex_t pool_lock = PTHREAD_MUTEX_INITIALIZER;
+static PooledMusic music_pool[MUSIC_POOL_SIZE];
+static Uint32 pool_clock = 0;
+static int current_index = -1;     // loaded (and usually playing) track
+static int pending_index = -1;     // fades in once the current one has faded out
+static int pending_fade_ms = 0;
+static unsigned long music_opens = 0;
+static unsigned long music_switches = 0;
 
-static Mix_Music* current_music = NULL;
 static Mix_Chunk* sounds[MAX_SOUNDS] = {NULL};
 
-bool audio_init(void) {
+// Loading and freeing music and chunks reads the mixer's output spec. Those
+// calls hold this for reading on whatever thread makes them; a reopen
+// (command thread) holds it for writing while the device is torn down.
+static pthread_rwlock_t device_lock = PTHREAD_RWLOCK_INITIALIZER;
+
+// Output spec the device was actually opened with. Chunks are converted to
+// it when they load and music streams when they open, so a reopen asks for
+// exactly this again.
+static int device_rate = AUDIO_RATE;
+static Uint16 device_format = MIX_DEFAULT_FORMAT;
+static int device_channels = 2;
+
+// What the mixer is doing with the music, published by the command thread
+// (and the music-finished hook) so the game thread never asks SDL_mixer,
+// which would take the mixer lock
+typedef enum {
+    MUSIC_STOPPED,
+    MUSIC_PLAYING,
+    MUSIC_FADING_OUT
+} MusicState;
+
+static atomic_int music_state;
+
+// Whether the game thread last asked for the music to play (game thread)
+static bool music_requested = false;
+
+// Playback requests from the game thread, carried out on the command thread
+// so that the game never waits for the mixer lock SDL holds while mixing
+typedef enum {
+    CMD_PLAY_SOUND,            // chunk
+    CMD_SOUND_VOLUME,          // chunk, value = volume
+    CMD_PLAY_MUSIC,            // music, value = fade-in ms (0 = start at once)
+    CMD_FADE_OUT_MUSIC,        // value = ms
+    CMD_HALT_MUSIC,
+    CMD_PAUSE_MUSIC,
+    CMD_RESUME_MUSIC,
+    CMD_MUSIC_VOLUME,          // value = volume
+    CMD_REOPEN,                // value = buffer frames, music = track to restart
+    CMD_QUIT
+} AudioCommandType;
+
+typedef struct {
+    AudioCommandType type;
+    int value;
+    Mix_Chunk* chunk;
+    Mix_Music* music;
+} AudioCommand;
+
+// Lock-free single producer (game thread) / single consumer (command thread)
+// ring. Each index is only written by its own side.
+static AudioCommand command_ring[COMMAND_RING_SIZE];
+static atomic_uint command_head;   // next slot to fill (producer)
+static atomic_uint command_tail;   // next slot to run (consumer)
+static sem_t command_signal;
+static pthread_t command_thread;
+static bool command_thread_running = false;
+
+// Mixer callback timing, written on SDL's audio thread. The audio thread
+// only ever try-locks: a sample that meets a reader is skipped, not waited for.
+static pthread_mutex_t stats_lock = PTHREAD_MUTEX_INITIALIZER;
+static AudioStats callback_stats;
+static Uint64 last_callback_counter = 0;
+static double last_callback_cpu_ms = 0.0;
+static int warmup_callbacks = 0;
+
+// Adaptive buffer sizing (game thread)
+static bool buffer_adaptive = false;
+static int requested_frames = 0;           // last size asked for
+static Uint32 underrun_window_start = 0;
+static unsigned long underrun_window_base = 0;
+
+static double thread_cpu_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+    return (double)ts.tv_sec * 1000.0 + (double)ts.tv_nsec / 1000000.0;
+}
+
+// Runs at the end of every mixer callback. The audio thread's CPU time
+// between two callbacks is what mixing a buffer costs.
+static void postmix_timing(void* udata, Uint8* stream, int len) {
+    (void)udata;
+    (void)stream;
+    (void)len;
+
+    Uint64 now = SDL_GetPerformanceCounter();
+    double cpu_ms = thread_cpu_ms();
+
+    if (warmup_callbacks > 0) {
+        warmup_callbacks--;
+    } else if (pthread_mutex_trylock(&stats_lock) == 0) {
+        double interval_ms = (double)(now - last_callback_counter) * 1000.0 /
+                             (double)SDL_GetPerformanceFrequency();
+        double mix_ms = cpu_ms - last_callback_cpu_ms;
+
+        // SDL keeps about two buffers queued on the device: a callback that
+        // comes two periods after the last one, or takes longer than one
+        // period to mix, means the device ran dry
+        AudioStats* st = &callback_stats;
+        if (interval_ms > 2.0 * st->period_ms || mix_ms > st->period_ms) {
+            st->underruns++;
+        } else if (interval_ms > 1.5 * st->period_ms) {
+            st->late_callbacks++;
+        }
+
+        st->callbacks++;
+        st->interval_total_ms += interval_ms;
+        st->mix_total_ms += mix_ms;
+        if (interval_ms > st->interval_max_ms) st->interval_max_ms = interval_ms;
+        if (mix_ms > st->mix_max_ms) st->mix_max_ms = mix_ms;
+        pthread_mutex_unlock(&stats_lock);
+    }
+
+    last_callback_counter = now;
+    last_callback_cpu_ms = cpu_ms;
+}
+
+// Opens the mixer with the device spec above and a buffer of frames, and
+// starts timing its callbacks
+static bool open_mixer(int frames) {
+    if (Mix_OpenAudio(device_rate, device_format, device_channels, frames) < 0) {
+        fprintf(stderr, "Audio: Failed to init SDL_mixer: %s\n", Mix_GetError());
+        return false;
+    }
+    
+    // Allocate mixing channels
+    Mix_AllocateChannels(16);
+    
+    // The device may run at another rate than asked for (e.g. 48 kHz),
+    // and the callback thresholds depend on the real period
+    int rate = device_rate;
+    Uint16 format = device_format;
+    int channels = device_channels;
+    if (Mix_QuerySpec(&rate, &format, &channels) == 0 || rate <= 0) {
+        rate = device_rate;
+        format = device_format;
+        channels = device_channels;
+    }
+    device_rate = rate;
+    device_format = format;
+    device_channels = channels;
+    
+    pthread_mutex_lock(&stats_lock);
+    callback_stats.buffer_frames = frames;
+    callback_stats.period_ms = frames * 1000.0 / rate;
+    pthread_mutex_unlock(&stats_lock);
+    warmup_callbacks = AUDIO_WARMUP_CALLBACKS;
+    Mix_SetPostMix(postmix_timing, NULL);
+    return true;
+}
+
+static bool same_spec(int rate, Uint16 format, int channels) {
+    return rate == device_rate && format == device_format && channels == device_channels;
+}
+
+// Command thread: reopens the device with another buffer size, asking for
+// the spec it has now. Loaded chunks and music streams were converted to
+// that spec, so they only play right if it comes back unchanged; otherwise
+// the device goes back to the previous buffer size, which it opened with
+// that spec before. The music that was playing restarts from the top. No
+// other thread loads or frees mixer objects meanwhile (device_lock).
+static void reopen_mixer(int frames, Mix_Music* playing) {
+    int volume = Mix_VolumeMusic(-1);
+    int previous = callback_stats.buffer_frames;
+    int rate = device_rate;
+    Uint16 format = device_format;
+    int channels = device_channels;
+    
+    pthread_rwlock_wrlock(&device_lock);
+    Mix_CloseAudio();
+    bool opened = open_mixer(frames);
+    if (opened && !same_spec(rate, format, channels)) {
+        fprintf(stderr, "Audio: Device reopened with another spec (%d Hz, was %d Hz), keeping %d frames\n",
+                device_rate, rate, previous);
+        Mix_CloseAudio();
+        opened = false;
+    }
+    if (!opened) {
+        device_rate = rate;
+        device_format = format;
+        device_channels = channels;
+        frames = previous;
+        opened = open_mixer(frames);
+        if (opened && !same_spec(rate, format, channels)) {
+            fprintf(stderr, "Audio: Device spec changed, loaded sounds may play at the wrong pitch\n");
+        }
+    }
+    pthread_rwlock_unlock(&device_lock);
+    if (!opened) {
+        return;
+    }
+    
+    Mix_VolumeMusic(volume);
+    if (playing && Mix_PlayMusic(playing, -1) < 0) {
+        fprintf(stderr, "Audio: Failed to play music: %s\n", Mix_GetError());
+    } else if (playing) {
+        atomic_store(&music_state, MUSIC_PLAYING);
+    }
+    printf("Audio: Mixer buffer now %d frames (%.1f ms)\n", frames, frames * 1000.0 / device_rate);
+}
+
+// Called by SDL_mixer when the music stops: on the audio thread at the end
+// of a fade-out, or on the command thread inside Mix_HaltMusic
+static void music_finished(void) {
+    atomic_store(&music_state, MUSIC_STOPPED);
+}
+
+static void run_command(const AudioCommand* cmd) {
+    switch (cmd->type) {
+    case CMD_PLAY_SOUND:
+        // Play on first available channel
+        if (Mix_PlayChannel(-1, cmd->chunk, 0) < 0) {
+            fprintf(stderr, "Audio: Failed to play sound: %s\n", Mix_GetError());
+        }
+        break;
+    case CMD_SOUND_VOLUME:
+        Mix_VolumeChunk(cmd->chunk, cmd->value);
+        break;
+    case CMD_PLAY_MUSIC: {
+        int result = cmd->value > 0 ? Mix_FadeInMusic(cmd->music, -1, cmd->value)
+                                    : Mix_PlayMusic(cmd->music, -1);
+        if (result < 0) {
+            fprintf(stderr, "Audio: Failed to play music: %s\n", Mix_GetError());
+        }
+        atomic_store(&music_state, result < 0 ? MUSIC_STOPPED : MUSIC_PLAYING);
+        break;
+    }
+    case CMD_FADE_OUT_MUSIC:
+        // Published first: the hook marks it stopped once the fade is over,
+        // which may happen on the audio thread before Mix_FadeOutMusic returns
+        atomic_store(&music_state, MUSIC_FADING_OUT);
+        if (!Mix_FadeOutMusic(cmd->value)) {
+            atomic_store(&music_state, MUSIC_STOPPED);
+        }
+        break;
+    case CMD_HALT_MUSIC:
+        Mix_HaltMusic();
+        atomic_store(&music_state, MUSIC_STOPPED);
+        break;
+    case CMD_PAUSE_MUSIC:
+        Mix_PauseMusic();
+        break;
+    case CMD_RESUME_MUSIC:
+        Mix_ResumeMusic();
+        break;
+    case CMD_MUSIC_VOLUME:
+        Mix_VolumeMusic(cmd->value);
+        break;
+    case CMD_REOPEN:
+        reopen_mixer(cmd->value, cmd->music);
+        break;
+    case CMD_QUIT:
+        break;
+    }
+}
+
+static void* command_main(void* arg) {
+    (void)arg;
+
+    for (;;) {
+        sem_wait(&command_signal);
+
+        unsigned tail = atomic_load_explicit(&command_tail, memory_order_relaxed);
+        while (tail != atomic_load_explicit(&command_head, memory_order_acquire)) {
+            AudioCommand cmd = command_ring[tail & (COMMAND_RING_SIZE - 1)];
+            if (cmd.type == CMD_QUIT) {
+                atomic_store_explicit(&command_tail, ++tail, memory_order_release);
+                return NULL;
+            }
+
+            // The slot is released only once the command has run, so
+            // flush_commands also waits for the one in progress
+            run_command(&cmd);
+            atomic_store_explicit(&command_tail, ++tail, memory_order_release);
+        }
+    }
+}
+
+// game thread only
+static void push_command(AudioCommandType type, int value, Mix_Chunk* chunk, Mix_Music* music) {
+    AudioCommand cmd = {type, value, chunk, music};
+    if (!command_thread_running) {
+        run_command(&cmd);
+        return;
+    }
+
+    unsigned head = atomic_load_explicit(&command_head, memory_order_relaxed);
+    // Full only if the command thread is stuck; wait rather than drop
+    while (head - atomic_load_explicit(&command_tail, memory_order_acquire) >= COMMAND_RING_SIZE) {
+        SDL_Delay(1);
+    }
+
+    command_ring[head & (COMMAND_RING_SIZE - 1)] = cmd;
+    atomic_store_explicit(&command_head, head + 1, memory_order_release);
+    sem_post(&command_signal);
+}
+
+static bool commands_pending(void) {
+    return atomic_load_explicit(&command_tail, memory_order_acquire) !=
+           atomic_load_explicit(&command_head, memory_order_relaxed);
+}
+
+// Wait until the command thread has run everything queued, including the
+// command it is running (before freeing something a command may point to)
+static void flush_commands(void) {
+    while (commands_pending()) {
+        SDL_Delay(1);
+    }
+}
+
+// caller holds pool_lock
+static int find_pooled(const char* filename) {
+    for (int i = 0; i < MUSIC_POOL_SIZE; i++) {
+        if (music_pool[i].music && strcmp(music_pool[i].path, filename) == 0) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+// caller holds pool_lock: a free slot, or the least recently used track that
+// is neither loaded nor about to fade in. Its stream goes to *evicted.
+static int take_slot(Mix_Music** evicted) {
+    int victim = -1;
+    for (int i = 0; i < MUSIC_POOL_SIZE; i++) {
+        if (!music_pool[i].music) {
+            return i;
+        }
+        if (i != current_index && i != pending_index &&
+            (victim < 0 || music_pool[i].last_used < music_pool[victim].last_used)) {
+            victim = i;
+        }
+    }
+    if (victim >= 0) {
+        printf("Audio: Dropping music '%s' from the pool\n", music_pool[victim].path);
+        *evicted = music_pool[victim].music;
+        music_pool[victim].music = NULL;
+    }
+    return victim;
+}
+
+// The pooled stream for filename, opened (from the pack or disk) if it is
+// not pooled yet. With claim, *claim is set to its slot under the lock, so
+// that no other thread can evict it in between.
+static Mix_Music* acquire_music(const char* filename, int* claim) {
+    pthread_mutex_lock(&pool_lock);
+    int index = find_pooled(filename);
+    if (index >= 0) {
+        music_pool[index].last_used = ++pool_clock;
+        if (claim) *claim = index;
+        Mix_Music* music = music_pool[index].music;
+        pthread_mutex_unlock(&pool_lock);
+        return music;
+    }
+    pthread_mutex_unlock(&pool_lock);
+
+    // Opened outside the lock: this reads and parses the stream headers.
+    // It then streams from the RWops (the mapped pack) for as long as it is pooled.
+    pthread_rwlock_rdlock(&device_lock);
+    Mix_Music* opened = Mix_LoadMUS_RW(asset_open(filename), 1);
+    pthread_rwlock_unlock(&device_lock);
+    if (!opened) {
+        fprintf(stderr, "Audio: Failed to load music '%s': %s\n", filename, Mix_GetError());
+        if (claim) *claim = -1;
+        return NULL;
+    }
+
+    Mix_Music* unused = NULL;
+    pthread_mutex_lock(&pool_lock);
+    index = find_pooled(filename);
+    if (index >= 0) {
+        unused = opened;       // another thread opened it meanwhile
+    } else {
+        index = take_slot(&unused);
+        if (index >= 0) {
+            snprintf(music_pool[index].path, sizeof(music_pool[index].path), "%s", filename);
+            music_pool[index].music = opened;
+            music_opens++;
+        }
+    }
+
+    Mix_Music* music = NULL;
+    if (index >= 0) {
+        music_pool[index].last_used = ++pool_clock;
+        music = music_pool[index].music;
+    } else {
+        fprintf(stderr, "Audio: Music pool full, cannot keep '%s'\n", filename);
+        unused = opened;
+    }
+    if (claim) *claim = index;
+    pthread_mutex_unlock(&pool_lock);
+
+    if (unused) {
+        pthread_rwlock_rdlock(&device_lock);
+        Mix_FreeMusic(unused);
+        pthread_rwlock_unlock(&device_lock);
+    }
+    return music;
+}
+
+bool audio_init(int buffer_frames) {
     printf("Audio: Initializing SDL_mixer\n");
     
     // Initialize SDL audio if not already initialized
@@ -19,28 +454,98 @@ bool audio_init(void) {
         }
     }
     
-    // Initialize SDL_mixer
-    if (Mix_OpenAudio(44100, MIX_DEFAULT_FORMAT, 2, 8192) < 0) {
-        fprintf(stderr, "Audio: Failed to init SDL_mixer: %s\n", Mix_GetError());
+    // Initialize SDL_mixer. The buffer sets the latency of a sound effect
+    // (256 frames are 5.8 ms at 44.1 kHz); without a fixed size it starts
+    // small and grows while the device keeps running dry.
+    buffer_adaptive = buffer_frames <= 0;
+    if (buffer_adaptive) {
+        buffer_frames = AUDIO_ADAPTIVE_START_FRAMES;
+    }
+    
+    pthread_mutex_lock(&stats_lock);
+    memset(&callback_stats, 0, sizeof(callback_stats));
+    pthread_mutex_unlock(&stats_lock);
+    device_rate = AUDIO_RATE;
+    device_format = MIX_DEFAULT_FORMAT;
+    device_channels = 2;
+    if (!open_mixer(buffer_frames)) {
         return false;
     }
+    atomic_store(&music_state, MUSIC_STOPPED);
+    music_requested = false;
+    Mix_HookMusicFinished(music_finished);
+    requested_frames = buffer_frames;
+    underrun_window_start = SDL_GetTicks();
+    underrun_window_base = 0;
     
-    // Allocate mixing channels
-    Mix_AllocateChannels(16);
+    atomic_store(&command_head, 0);
+    atomic_store(&command_tail, 0);
+    if (sem_init(&command_signal, 0, 0) == 0 &&
+        pthread_create(&command_thread, NULL, command_main, NULL) == 0) {
+        command_thread_running = true;
+    } else {
+        fprintf(stderr, "Audio: No command thread, playing from the game thread\n");
+    }
     
-    printf("Audio: Successfully initialized\n");
+    printf("Audio: Successfully initialized (%d Hz, %d frame buffer, %.1f ms%s)\n",
+           device_rate, buffer_frames, buffer_frames * 1000.0 / device_rate,
+           buffer_adaptive ? ", adaptive" : "");
     return true;
 }
 
+void audio_get_stats(AudioStats* out) {
+    if (!out) {
+        return;
+    }
+    pthread_mutex_lock(&stats_lock);
+    *out = callback_stats;
+    pthread_mutex_unlock(&stats_lock);
+}
+
+static void print_callback_stats(void) {
+    AudioStats st;
+    audio_get_stats(&st);
+    if (st.callbacks == 0) {
+        return;
+    }
+    
+    printf("Audio: %lu callbacks every %.1f ms: interval avg %.2f / max %.2f ms, "
+           "mix avg %.3f / max %.3f ms, headroom %.2f ms\n",
+           st.callbacks, st.period_ms,
+           st.interval_total_ms / st.callbacks, st.interval_max_ms,
+           st.mix_total_ms / st.callbacks, st.mix_max_ms,
+           st.period_ms - st.mix_max_ms);
+    printf("Audio: %lu underruns, %lu late callbacks, buffer grown %d times to %d frames\n",
+           st.underruns, st.late_callbacks, st.buffer_growths, st.buffer_frames);
+}
+
 void audio_cleanup(void) {
-    printf("Audio: Cleanup\n");
+    printf("Audio: Cleanup (%lu music streams opened, %lu track switches)\n",
+           music_opens, music_switches);
+    print_callback_stats();
+    
+    // Let the command thread finish what is queued, then stop it
+    if (command_thread_running) {
+        push_command(CMD_QUIT, 0, NULL, NULL);
+        pthread_join(command_thread, NULL);
+        sem_destroy(&command_signal);
+        command_thread_running = false;
+    }
+    Mix_SetPostMix(NULL, NULL);
+    Mix_HookMusicFinished(NULL);
     
     // Stop and free music
-    if (current_music) {
-        Mix_HaltMusic();
-        Mix_FreeMusic(current_music);
-        current_music = NULL;
+    Mix_HaltMusic();
+    pthread_mutex_lock(&pool_lock);
+    for (int i = 0; i < MUSIC_POOL_SIZE; i++) {
+        if (music_pool[i].music) {
+            Mix_FreeMusic(music_pool[i].music);
+            music_pool[i].music = NULL;
+        }
     }
+    current_index = -1;
+    pending_index = -1;
+    pthread_mutex_unlock(&pool_lock);
     
     // Free all sounds
     for (int i = 0; i < MAX_SOUNDS; i++) {
@@ -57,16 +562,14 @@ void audio_cleanup(void) {
 bool audio_load_music(const char* filename) {
     printf("Audio: Loading music '%s'\n", filename);
     
-    // Free previous music if any
-    if (current_music) {
-        Mix_HaltMusic();
-        Mix_FreeMusic(current_music);
-        current_music = NULL;
-    }
+    // The previous track stays pooled, it is only stopped
+    push_command(CMD_HALT_MUSIC, 0, NULL, NULL);
+    music_requested = false;
+    pthread_mutex_lock(&pool_lock);
+    pending_index = -1;
+    pthread_mutex_unlock(&pool_lock);
     
-    current_music = Mix_LoadMUS(filename);
-    if (!current_music) {
-        fprintf(stderr, "Audio: Failed to load music '%s': %s\n", filename, Mix_GetError());
+    if (!acquire_music(filename, &current_index)) {
         return false;
     }
     
@@ -74,31 +577,139 @@ bool audio_load_music(const char* filename) {
     return true;
 }
 
+bool audio_prefetch_music(const char* filename) {
+    return filename && acquire_music(filename, NULL) != NULL;
+}
+
+bool audio_music_is_ready(const char* filename) {
+    if (!filename) {
+        return false;
+    }
+    
+    pthread_mutex_lock(&pool_lock);
+    bool ready = find_pooled(filename) >= 0;
+    pthread_mutex_unlock(&pool_lock);
+    return ready;
+}
+
+bool audio_crossfade_music(const char* filename, int fade_ms) {
+    if (!filename) {
+        return false;
+    }
+    
+    // Already on it (and not leaving it): nothing to do. Decided on what
+    // was asked for, which queued commands will make true, not on the mixer.
+    if (current_index >= 0 && pending_index < 0 &&
+        strcmp(music_pool[current_index].path, filename) == 0) {
+        if (!music_requested) {
+            audio_play_music();
+        }
+        return true;
+    }
+    
+    if (!acquire_music(filename, &pending_index)) {
+        return false;
+    }
+    
+    // One stream plays at a time: fade the current one out, then the new
+    // one in (see audio_update)
+    pending_fade_ms = fade_ms / 2;
+    if (music_requested) {
+        push_command(CMD_FADE_OUT_MUSIC, pending_fade_ms, NULL, NULL);
+        music_requested = false;
+    }
+    music_switches++;
+    printf("Audio: Crossfading to '%s' over %d ms\n", filename, fade_ms);
+    
+    audio_update();
+    return true;
+}
+
+// Doubles the buffer once the underruns within a window cross the threshold
+static void adapt_buffer(void) {
+    if (!buffer_adaptive || !command_thread_running) {
+        return;
+    }
+    
+    AudioStats st;
+    audio_get_stats(&st);
+    Uint32 now = SDL_GetTicks();
+    
+    // Wait for a requested size to take effect before judging it
+    if (st.buffer_frames != requested_frames) {
+        underrun_window_start = now;
+        underrun_window_base = st.underruns;
+        return;
+    }
+    
+    if (st.underruns - underrun_window_base >= AUDIO_UNDERRUN_THRESHOLD &&
+        requested_frames < AUDIO_ADAPTIVE_MAX_FRAMES) {
+        requested_frames *= 2;
+        printf("Audio: %lu underruns in %u ms, growing the buffer to %d frames\n",
+               st.underruns - underrun_window_base, now - underrun_window_start, requested_frames);
+        
+        pthread_mutex_lock(&stats_lock);
+        callback_stats.buffer_growths++;
+        pthread_mutex_unlock(&stats_lock);
+        
+        bool playing_now = atomic_load(&music_state) == MUSIC_PLAYING;
+        Mix_Music* playing = current_index >= 0 && playing_now ? music_pool[current_index].music : NULL;
+        push_command(CMD_REOPEN, requested_frames, NULL, playing);
+        underrun_window_start = now;
+        underrun_window_base = st.underruns;
+    } else if (now - underrun_window_start >= AUDIO_UNDERRUN_WINDOW_MS) {
+        underrun_window_start = now;
+        underrun_window_base = st.underruns;
+    }
+}
+
+void audio_update(void) {
+    adapt_buffer();
+    
+    // The mixer state only catches up once queued commands have run; the
+    // next track starts once the fade-out has finished
+    if (pending_index < 0 || commands_pending() ||
+        atomic_load(&music_state) != MUSIC_STOPPED) {
+        return;
+    }
+    
+    pthread_mutex_lock(&pool_lock);
+    current_index = pending_index;
+    pending_index = -1;
+    Mix_Music* music = music_pool[current_index].music;
+    pthread_mutex_unlock(&pool_lock);
+    
+    push_command(CMD_PLAY_MUSIC, pending_fade_ms > 0 ? pending_fade_ms : 0, NULL, music);
+    music_requested = true;
+}
+
 void audio_play_music(void) {
-    if (!current_music) {
+    if (current_index < 0) {
         fprintf(stderr, "Audio: No music loaded\n");
         return;
     }
     
-    if (Mix_PlayMusic(current_music, -1) < 0) {
-        fprintf(stderr, "Audio: Failed to play music: %s\n", Mix_GetError());
-    } else {
-        printf("Audio: Playing music (looping)\n");
-    }
+    push_command(CMD_PLAY_MUSIC, 0, NULL, music_pool[current_index].music);
+    music_requested = true;
+    printf("Audio: Playing music (looping)\n");
 }
 
 void audio_stop_music(void) {
-    Mix_HaltMusic();
+    push_command(CMD_HALT_MUSIC, 0, NULL, NULL);
+    music_requested = false;
+    pthread_mutex_lock(&pool_lock);
+    pending_index = -1;
+    pthread_mutex_unlock(&pool_lock);
     printf("Audio: Music stopped\n");
 }
 
 void audio_pause_music(void) {
-    Mix_PauseMusic();
+    push_command(CMD_PAUSE_MUSIC, 0, NULL, NULL);
     printf("Audio: Music paused\n");
 }
 
 void audio_resume_music(void) {
-    Mix_ResumeMusic();
+    push_command(CMD_RESUME_MUSIC, 0, NULL, NULL);
     printf("Audio: Music resumed\n");
 }
 
@@ -106,7 +717,7 @@ void audio_set_music_volume(int volume) {
     // Volume range: 0-128
     if (volume < 0) volume = 0;
     if (volume > 128) volume = 128;
-    Mix_VolumeMusic(volume);
+    push_command(CMD_MUSIC_VOLUME, volume, NULL, NULL);
 }
 
 bool audio_load_sound(const char* filename, int sound_id) {
@@ -117,15 +728,17 @@ bool audio_load_sound(const char* filename, int sound_id) {
     
     printf("Audio: Loading sound '%s' with id %d\n", filename, sound_id);
     
-    // Free previous sound if any
+    // Free previous sound if any (once no queued command refers to it)
     if (sounds[sound_id]) {
+        flush_commands();
+        pthread_rwlock_rdlock(&device_lock);
         Mix_FreeChunk(sounds[sound_id]);
+        pthread_rwlock_unlock(&device_lock);
         sounds[sound_id] = NULL;
     }
     
-    sounds[sound_id] = Mix_LoadWAV(filename);
+    sounds[sound_id] = audio_read_sound(filename);
     if (!sounds[sound_id]) {
-        fprintf(stderr, "Audio: Failed to load sound '%s': %s\n", filename, Mix_GetError());
         return false;
     }
     
@@ -133,6 +746,35 @@ bool audio_load_sound(const char* filename, int sound_id) {
     return true;
 }
 
+Mix_Chunk* audio_read_sound(const char* filename) {
+    pthread_rwlock_rdlock(&device_lock);
+    Mix_Chunk* chunk = Mix_LoadWAV_RW(asset_open(filename), 1);
+    pthread_rwlock_unlock(&device_lock);
+    if (!chunk) {
+        fprintf(stderr, "Audio: Failed to load sound '%s': %s\n", filename, Mix_GetError());
+    }
+    return chunk;
+}
+
+bool audio_set_sound(int sound_id, Mix_Chunk* chunk) {
+    if (sound_id < 0 || sound_id >= MAX_SOUNDS) {
+        fprintf(stderr, "Audio: Invalid sound ID %d\n", sound_id);
+        pthread_rwlock_rdlock(&device_lock);
+        Mix_FreeChunk(chunk);
+        pthread_rwlock_unlock(&device_lock);
+        return false;
+    }
+
+    if (sounds[sound_id]) {
+        flush_commands();
+        pthread_rwlock_rdlock(&device_lock);
+        Mix_FreeChunk(sounds[sound_id]);
+        pthread_rwlock_unlock(&device_lock);
+    }
+    sounds[sound_id] = chunk;
+    return chunk != NULL;
+}
+
 void audio_play_sound(int sound_id) {
     if (sound_id < 0 || sound_id >= MAX_SOUNDS) {
         fprintf(stderr, "Audio: Invalid sound ID %d\n", sound_id);
@@ -144,10 +786,7 @@ void audio_play_sound(int sound_id) {
         return;
     }
     
-    // Play on first available channel
-    if (Mix_PlayChannel(-1, sounds[sound_id], 0) < 0) {
-        fprintf(stderr, "Audio: Failed to play sound: %s\n", Mix_GetError());
-    }
+    push_command(CMD_PLAY_SOUND, 0, sounds[sound_id], NULL);
 }
 
 void audio_set_sound_volume(int sound_id, int volume) {
@@ -159,6 +798,6 @@ void audio_set_sound_volume(int sound_id, int volume) {
         // Volume range: 0-128
         if (volume < 0) volume = 0;
         if (volume > 128) volume = 128;
-        Mix_VolumeChunk(sounds[sound_id], volume);
+        push_command(CMD_SOUND_VOLUME, volume, sounds[sound_id], NULL);
     }
 }
\ No newline at end of file
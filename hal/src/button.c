@@ -1,3 +1,5 @@
+#define _POSIX_C_SOURCE 200809L
+
 #include "button.h"
 #include <stdio.h>
 
@@ -6,160 +8,252 @@
 
 #include <gpiod.h>
 #include <stdlib.h>
+#include <time.h>
 #include <unistd.h>
 
 #define CHIP_NAME "/dev/gpiochip2"
 #define LINE_CATCH_BUTTON 13 // GPIO for catch/interact
 #define LINE_RESET_BUTTON 14 // GPIO for reset
 
+// Edges closer than this to the last accepted change are contact bounce
+#define BUTTON_DEBOUNCE_NS (15ull * 1000000ull)
+
+// Debounced edges waiting for a consumer, per button
+#define BUTTON_QUEUE_SIZE 16
+
+// Edge events read from the kernel in one go
+#define EDGE_BUFFER_SIZE 16
+
+typedef struct
+{
+    unsigned int offset;
+    const char *consumer;
+    struct gpiod_line_request *request;
+
+    bool pressed;        // debounced level
+    uint64_t changed_ns; // kernel time of the last debounced change
+    bool raw_pressed;    // level after the last edge, bounces included
+    uint64_t raw_ns;
+    unsigned long bounces;
+
+    // debounced changes not handed out yet, oldest first
+    bool edge_pressed[BUTTON_QUEUE_SIZE];
+    uint64_t edge_ns[BUTTON_QUEUE_SIZE];
+    int edge_head;
+    int edge_count;
+} Button;
+
 static struct gpiod_chip *chip;
-static struct gpiod_line_request *catch_request;
-static struct gpiod_line_request *reset_request;
-static bool last_catch_state = false;
-static bool last_reset_state = false;
+static struct gpiod_edge_event_buffer *edge_buffer;
+static Button buttons[BUTTON_COUNT] = {
+    [BUTTON_CATCH] = {.offset = LINE_CATCH_BUTTON, .consumer = "catch_button"},
+    [BUTTON_RESET] = {.offset = LINE_RESET_BUTTON, .consumer = "reset_button"},
+};
 
-void button_initialize(void)
+static void fail(const char *what)
 {
-    // Open the GPIO chip
-    chip = gpiod_chip_open(CHIP_NAME);
-    if (!chip)
-    {
-        perror("button: gpiod_chip_open");
-        exit(1);
-    }
+    perror(what);
+    button_cleanup();
+    exit(1);
+}
 
-    // ===== CATCH BUTTON (LINE 13) =====
-    struct gpiod_line_settings *catch_settings = gpiod_line_settings_new();
-    if (!catch_settings)
-    {
-        perror("button: gpiod_line_settings_new (catch)");
-        gpiod_chip_close(chip);
-        exit(1);
-    }
-    gpiod_line_settings_set_direction(catch_settings, GPIOD_LINE_DIRECTION_INPUT);
-    gpiod_line_settings_set_bias(catch_settings, GPIOD_LINE_BIAS_PULL_UP);
+// requests a pulled-up input line reporting both edges with
+// CLOCK_MONOTONIC kernel timestamps
+static struct gpiod_line_request *request_button_line(const Button *button)
+{
+    struct gpiod_line_settings *settings = gpiod_line_settings_new();
+    if (!settings)
+        fail("button: gpiod_line_settings_new");
+
+    gpiod_line_settings_set_direction(settings, GPIOD_LINE_DIRECTION_INPUT);
+    gpiod_line_settings_set_bias(settings, GPIOD_LINE_BIAS_PULL_UP);
+    gpiod_line_settings_set_edge_detection(settings, GPIOD_LINE_EDGE_BOTH);
+    gpiod_line_settings_set_event_clock(settings, GPIOD_LINE_CLOCK_MONOTONIC);
 
-    struct gpiod_line_config *catch_config = gpiod_line_config_new();
-    if (!catch_config)
+    struct gpiod_line_config *config = gpiod_line_config_new();
+    if (!config)
     {
-        perror("button: gpiod_line_config_new (catch)");
-        gpiod_line_settings_free(catch_settings);
-        gpiod_chip_close(chip);
-        exit(1);
+        gpiod_line_settings_free(settings);
+        fail("button: gpiod_line_config_new");
     }
-    unsigned int catch_offset = LINE_CATCH_BUTTON;
-    gpiod_line_config_add_line_settings(catch_config, &catch_offset, 1, catch_settings);
+    gpiod_line_config_add_line_settings(config, &button->offset, 1, settings);
 
-    struct gpiod_request_config *catch_reqConfig = gpiod_request_config_new();
-    if (!catch_reqConfig)
+    struct gpiod_request_config *reqConfig = gpiod_request_config_new();
+    if (!reqConfig)
     {
-        perror("button: gpiod_request_config_new (catch)");
-        gpiod_line_config_free(catch_config);
-        gpiod_line_settings_free(catch_settings);
-        gpiod_chip_close(chip);
-        exit(1);
+        gpiod_line_config_free(config);
+        gpiod_line_settings_free(settings);
+        fail("button: gpiod_request_config_new");
     }
-    gpiod_request_config_set_consumer(catch_reqConfig, "catch_button");
+    gpiod_request_config_set_consumer(reqConfig, button->consumer);
 
-    catch_request = gpiod_chip_request_lines(chip, catch_reqConfig, catch_config);
+    struct gpiod_line_request *request = gpiod_chip_request_lines(chip, reqConfig, config);
 
-    gpiod_request_config_free(catch_reqConfig);
-    gpiod_line_config_free(catch_config);
-    gpiod_line_settings_free(catch_settings);
+    gpiod_request_config_free(reqConfig);
+    gpiod_line_config_free(config);
+    gpiod_line_settings_free(settings);
 
-    if (!catch_request)
-    {
-        perror("button: gpiod_chip_request_lines (catch)");
-        gpiod_chip_close(chip);
-        exit(1);
-    }
+    if (!request)
+        fail("button: gpiod_chip_request_lines");
+    return request;
+}
 
-    // ===== RESET BUTTON (LINE 14) =====
-    struct gpiod_line_settings *reset_settings = gpiod_line_settings_new();
-    if (!reset_settings)
-    {
-        perror("button: gpiod_line_settings_new (reset)");
-        gpiod_line_request_release(catch_request);
-        gpiod_chip_close(chip);
-        exit(1);
-    }
-    gpiod_line_settings_set_direction(reset_settings, GPIOD_LINE_DIRECTION_INPUT);
-    gpiod_line_settings_set_bias(reset_settings, GPIOD_LINE_BIAS_PULL_UP);
+void button_initialize(void)
+{
+    // Open the GPIO chip
+    chip = gpiod_chip_open(CHIP_NAME);
+    if (!chip)
+        fail("button: gpiod_chip_open");
+
+    edge_buffer = gpiod_edge_event_buffer_new(EDGE_BUFFER_SIZE);
+    if (!edge_buffer)
+        fail("button: gpiod_edge_event_buffer_new");
 
-    struct gpiod_line_config *reset_config = gpiod_line_config_new();
-    if (!reset_config)
+    for (int i = 0; i < BUTTON_COUNT; i++)
     {
-        perror("button: gpiod_line_config_new (reset)");
-        gpiod_line_settings_free(reset_settings);
-        gpiod_line_request_release(catch_request);
-        gpiod_chip_close(chip);
-        exit(1);
+        Button *button = &buttons[i];
+        button->request = request_button_line(button);
+
+        // Start from the current level (active low)
+        button->pressed = gpiod_line_request_get_value(button->request, button->offset) == GPIOD_LINE_VALUE_INACTIVE;
+        button->raw_pressed = button->pressed;
+        button->changed_ns = 0;
+        button->raw_ns = 0;
+        button->bounces = 0;
+        button->edge_head = 0;
+        button->edge_count = 0;
+
+        printf("[Button] Initialized %s on line %u (edge events)\n", button->consumer, button->offset);
     }
-    unsigned int reset_offset = LINE_RESET_BUTTON;
-    gpiod_line_config_add_line_settings(reset_config, &reset_offset, 1, reset_settings);
+}
 
-    struct gpiod_request_config *reset_reqConfig = gpiod_request_config_new();
-    if (!reset_reqConfig)
+static uint64_t monotonic_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+static void set_pressed(Button *button, bool pressed, uint64_t timestamp_ns)
+{
+    button->pressed = pressed;
+    button->changed_ns = timestamp_ns;
+
+    // Queue the change; a consumer that falls this far behind loses the oldest
+    if (button->edge_count == BUTTON_QUEUE_SIZE)
     {
-        perror("button: gpiod_request_config_new (reset)");
-        gpiod_line_config_free(reset_config);
-        gpiod_line_settings_free(reset_settings);
-        gpiod_line_request_release(catch_request);
-        gpiod_chip_close(chip);
-        exit(1);
+        button->edge_head = (button->edge_head + 1) % BUTTON_QUEUE_SIZE;
+        button->edge_count--;
     }
-    gpiod_request_config_set_consumer(reset_reqConfig, "reset_button");
+    int tail = (button->edge_head + button->edge_count) % BUTTON_QUEUE_SIZE;
+    button->edge_pressed[tail] = pressed;
+    button->edge_ns[tail] = timestamp_ns;
+    button->edge_count++;
+}
 
-    reset_request = gpiod_chip_request_lines(chip, reset_reqConfig, reset_config);
+static void handle_edge(Button *button, bool pressed, uint64_t timestamp_ns)
+{
+    button->raw_pressed = pressed;
+    button->raw_ns = timestamp_ns;
 
-    gpiod_request_config_free(reset_reqConfig);
-    gpiod_line_config_free(reset_config);
-    gpiod_line_settings_free(reset_settings);
+    if (pressed != button->pressed && timestamp_ns - button->changed_ns >= BUTTON_DEBOUNCE_NS)
+        set_pressed(button, pressed, timestamp_ns);
+    else
+        button->bounces++;
+}
 
-    if (!reset_request)
+void button_update(void)
+{
+    for (int i = 0; i < BUTTON_COUNT; i++)
     {
-        perror("button: gpiod_chip_request_lines (reset)");
-        gpiod_line_request_release(catch_request);
-        gpiod_chip_close(chip);
-        exit(1);
+        Button *button = &buttons[i];
+        if (!button->request)
+            continue;
+
+        // Drain the edges the kernel queued since the last call
+        while (gpiod_line_request_wait_edge_events(button->request, 0) > 0)
+        {
+            int count = gpiod_line_request_read_edge_events(button->request, edge_buffer, EDGE_BUFFER_SIZE);
+            if (count <= 0)
+                break;
+
+            for (int e = 0; e < count; e++)
+            {
+                struct gpiod_edge_event *event = gpiod_edge_event_buffer_get_event(edge_buffer, e);
+                bool pressed = gpiod_edge_event_get_event_type(event) == GPIOD_EDGE_EVENT_FALLING_EDGE; // Active low
+                handle_edge(button, pressed, gpiod_edge_event_get_timestamp_ns(event));
+            }
+        }
+
+        // A level that was dropped as bounce but has held since then is real
+        // (e.g. a release right after a very short press). Sampled after
+        // draining, so no edge read above is newer than now.
+        uint64_t now = monotonic_ns();
+        if (button->raw_ns <= now && button->raw_pressed != button->pressed && now - button->raw_ns >= BUTTON_DEBOUNCE_NS)
+            set_pressed(button, button->raw_pressed, button->raw_ns);
     }
+}
 
-    // Initialize last states
-    last_catch_state = button_catch_isPressed();
-    last_reset_state = button_reset_isPressed();
+bool button_take_edge(ButtonId id, bool *pressed, uint64_t *timestamp_ns)
+{
+    if (id < 0 || id >= BUTTON_COUNT)
+        return false;
+
+    button_update();
+
+    Button *button = &buttons[id];
+    if (button->edge_count == 0)
+        return false;
+
+    if (pressed)
+        *pressed = button->edge_pressed[button->edge_head];
+    if (timestamp_ns)
+        *timestamp_ns = button->edge_ns[button->edge_head];
+    button->edge_head = (button->edge_head + 1) % BUTTON_QUEUE_SIZE;
+    button->edge_count--;
+    return true;
+}
 
-    printf("[Button] Initialized catch button on line 13\n");
-    printf("[Button] Initialized reset button on line 14\n");
+bool button_take_press(ButtonId id, uint64_t *timestamp_ns)
+{
+    bool pressed;
+    while (button_take_edge(id, &pressed, timestamp_ns))
+    {
+        if (pressed)
+            return true;
+    }
+    return false;
+}
+
+int button_get_fd(ButtonId id)
+{
+    if (id < 0 || id >= BUTTON_COUNT || !buttons[id].request)
+        return -1;
+    return gpiod_line_request_get_fd(buttons[id].request);
 }
 
 // ===== CATCH BUTTON FUNCTIONS =====
 bool button_catch_isPressed(void)
 {
-    int value = gpiod_line_request_get_value(catch_request, LINE_CATCH_BUTTON);
-    return (value == 0); // Active low
+    button_update();
+    return buttons[BUTTON_CATCH].pressed;
 }
 
 bool button_catch_wasJustPressed(void)
 {
-    bool current_state = button_catch_isPressed();
-    bool just_pressed = (current_state && !last_catch_state);
-    last_catch_state = current_state;
-    return just_pressed;
+    return button_take_press(BUTTON_CATCH, NULL);
 }
 
 // ===== RESET BUTTON FUNCTIONS =====
 bool button_reset_isPressed(void)
 {
-    int value = gpiod_line_request_get_value(reset_request, LINE_RESET_BUTTON);
-    return (value == 0); // Active low
+    button_update();
+    return buttons[BUTTON_RESET].pressed;
 }
 
 bool button_reset_wasJustPressed(void)
 {
-    bool current_state = button_reset_isPressed();
-    bool just_pressed = (current_state && !last_reset_state);
-    last_reset_state = current_state;
-    return just_pressed;
+    return button_take_press(BUTTON_RESET, NULL);
 }
 
 bool button_wasJustPressed(void)
@@ -169,15 +263,19 @@ bool button_wasJustPressed(void)
 
 void button_cleanup(void)
 {
-    if (catch_request)
+    for (int i = 0; i < BUTTON_COUNT; i++)
     {
-        gpiod_line_request_release(catch_request);
-        catch_request = NULL;
+        if (buttons[i].request)
+        {
+            gpiod_line_request_release(buttons[i].request);
+            buttons[i].request = NULL;
+            printf("[Button] %s: %lu bounces filtered\n", buttons[i].consumer, buttons[i].bounces);
+        }
     }
-    if (reset_request)
+    if (edge_buffer)
     {
-        gpiod_line_request_release(reset_request);
-        reset_request = NULL;
+        gpiod_edge_event_buffer_free(edge_buffer);
+        edge_buffer = NULL;
     }
     if (chip)
     {
@@ -215,6 +313,31 @@ bool button_reset_wasJustPressed(void)
     return false;
 }
 
+void button_update(void)
+{
+}
+
+bool button_take_edge(ButtonId id, bool *pressed, uint64_t *timestamp_ns)
+{
+    (void)id;
+    (void)pressed;
+    (void)timestamp_ns;
+    return false;
+}
+
+bool button_take_press(ButtonId id, uint64_t *timestamp_ns)
+{
+    (void)id;
+    (void)timestamp_ns;
+    return false;
+}
+
+int button_get_fd(ButtonId id)
+{
+    (void)id;
+    return -1;
+}
+
 bool button_isPressed(void)
 {
     return false;
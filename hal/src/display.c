@@ -1,11 +1,133 @@
+#define _POSIX_C_SOURCE 200809L
 #include "display.h"
+#include "residency.h"
+#include <limits.h>
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define DAMAGE_MAX_COLS 64
+#define DAMAGE_MAX_ROWS 64
+#define DAMAGE_MAX_RECTS 16
+#define DAMAGE_FULL_PERCENT 60 // above this, repaint everything in one pass
+#define DAMAGE_MAX_REGIONS 3   // regions handed out per frame, each costs a scene pass
+#define DAMAGE_UNION_SLACK 2   // one pass over the union while it is at most this
+                               // many times the damaged area
+#define TARGET_STACK_DEPTH 4
+#define LATENCY_HISTORY 256 // inputs kept for the latency percentiles
+
+#define HEADLESS_WIDTH 800 // same panel size as the target LCD
+#define HEADLESS_HEIGHT 480
 
 static SDL_Window *window = NULL;
 static SDL_Renderer *renderer = NULL;
+static SDL_Surface *headless_surface = NULL; // offscreen target in headless modes
+static DisplayMode display_mode = DISPLAY_MODE_WINDOW;
+static int logical_w = 0;
+static int logical_h = 0;
+
+// Persistent back buffer at output resolution; only damaged regions of it
+// are redrawn each frame
+static SDL_Texture *back_buffer = NULL;
+static float back_scale_x = 1.0f;
+static float back_scale_y = 1.0f;
+static bool back_buffer_bound = false;
+
+// Damage grid: one flag per cell of the logical screen
+static int damage_cell = 64;
+static int damage_cols = 0;
+static int damage_rows = 0;
+static bool damage_cells[DAMAGE_MAX_ROWS][DAMAGE_MAX_COLS];
+static bool damage_everything = true;
+static SDL_Rect damage_rects[DAMAGE_MAX_RECTS];
+
+static DisplayRepaintStats repaint_stats = {0};
+
+// Input whose effect is in the frame being built (id 0: none)
+static unsigned long pending_input_id = 0;
+static uint64_t pending_input_ns = 0;
+
+static double latency_ms[LATENCY_HISTORY];
+static int latency_count = 0;
+static int latency_head = 0;
+static unsigned long latency_inputs = 0;
+
+typedef struct
+{
+    SDL_Texture *target;
+    float scale_x;
+    float scale_y;
+    bool clip_enabled;
+    SDL_Rect clip;
+} TargetState;
+
+static TargetState target_stack[TARGET_STACK_DEPTH];
+static int target_depth = 0;
+
+// sets the logical size and the state that depends on it
+static void finish_init(int width, int height, int physical_w, int physical_h)
+{
+    // Set logical size to scale game content
+    SDL_RenderSetLogicalSize(renderer, width, height);
+    logical_w = width;
+    logical_h = height;
+    display_set_damage_cell(damage_cell);
+
+    // Use linear filtering for smooth scaling
+    SDL_SetHint(SDL_HINT_RENDER_SCALE_QUALITY, "1");
+
+    printf("SDL2 initialized successfully!\n");
+    printf("Logical size: %dx%d, Physical size: %dx%d\n",
+           width, height, physical_w, physical_h);
+}
+
+// renders into an offscreen software surface with no window or GPU
+static bool init_headless(int width, int height)
+{
+    // The dummy video driver keeps events and keyboard state working
+    SDL_setenv("SDL_VIDEODRIVER", "dummy", 1);
+    if (SDL_Init(SDL_INIT_VIDEO) < 0)
+    {
+        printf("SDL could not initialize! SDL_Error: %s\n", SDL_GetError());
+        return false;
+    }
+
+    // Software mode draws at the panel size, so scaling, clipping and fill
+    // cost match the target. Null mode hands out no regions to draw (see
+    // display_begin_frame); the surface only backs the renderer.
+    headless_surface = SDL_CreateRGBSurfaceWithFormat(0, HEADLESS_WIDTH, HEADLESS_HEIGHT, 32,
+                                                      SDL_PIXELFORMAT_ARGB8888);
+    if (!headless_surface)
+    {
+        printf("Offscreen surface could not be created! SDL_Error: %s\n", SDL_GetError());
+        return false;
+    }
+
+    // The software renderer never waits for a refresh
+    renderer = SDL_CreateSoftwareRenderer(headless_surface);
+    if (renderer == NULL)
+    {
+        printf("Renderer could not be created! SDL_Error: %s\n", SDL_GetError());
+        return false;
+    }
+
+    printf("Headless display (%s)\n", display_mode == DISPLAY_MODE_HEADLESS_NULL ? "null" : "software");
+    finish_init(width, height, HEADLESS_WIDTH, HEADLESS_HEIGHT);
+    return true;
+}
 
 bool display_init(const char *title, int width, int height)
 {
+    return display_init_mode(title, width, height, DISPLAY_MODE_WINDOW);
+}
+
+bool display_init_mode(const char *title, int width, int height, DisplayMode mode)
+{
+    display_mode = mode;
+    if (mode != DISPLAY_MODE_WINDOW)
+        return init_headless(width, height);
+
     // Try kmsdrm first (for BeagleY-AI LCD), fallback to default for host
     if (SDL_setenv("SDL_VIDEODRIVER", "kmsdrm", 0) == 0)
     {
@@ -84,21 +206,41 @@ bool display_init(const char *title, int width, int height)
         return false;
     }
 
-    // Set logical size to scale game content
-    SDL_RenderSetLogicalSize(renderer, width, height);
-
-    // Use linear filtering for smooth scaling
-    SDL_SetHint(SDL_HINT_RENDER_SCALE_QUALITY, "1");
-
-    printf("SDL2 initialized successfully!\n");
-    printf("Logical size: %dx%d, Physical size: %dx%d\n",
-           width, height, window_w, window_h);
-
+    finish_init(width, height, window_w, window_h);
     return true;
 }
 
 void display_cleanup(void)
 {
+    if (repaint_stats.frames > 0 && repaint_stats.frame_area > 0)
+    {
+        printf("Display: %lu frames, %lu full repaints, %.1f%% of the frame area repainted on average\n",
+               repaint_stats.frames, repaint_stats.full_frames,
+               100.0 * (double)repaint_stats.total_area /
+                   ((double)repaint_stats.frame_area * (double)repaint_stats.frames));
+    }
+
+    DisplayLatencyStats latency;
+    display_get_latency_stats(&latency);
+    if (latency.history > 0)
+    {
+        printf("Display: input to present over the last %d of %lu inputs: p50 %.1f ms, p95 %.1f ms, p99 %.1f ms, worst %.1f ms\n",
+               latency.history, latency.inputs, latency.p50_ms, latency.p95_ms,
+               latency.p99_ms, latency.worst_ms);
+    }
+    latency_count = 0;
+    latency_head = 0;
+    latency_inputs = 0;
+    pending_input_id = 0;
+
+    if (back_buffer)
+    {
+        residency_untrack(back_buffer);
+        SDL_DestroyTexture(back_buffer);
+        back_buffer = NULL;
+    }
+    back_buffer_bound = false;
+
     if (renderer)
     {
         SDL_DestroyRenderer(renderer);
@@ -109,6 +251,11 @@ void display_cleanup(void)
         SDL_DestroyWindow(window);
         window = NULL;
     }
+    if (headless_surface)
+    {
+        SDL_FreeSurface(headless_surface);
+        headless_surface = NULL;
+    }
     SDL_Quit();
 }
 
@@ -120,10 +267,433 @@ SDL_Renderer *display_get_renderer(void)
 void display_clear(int r, int g, int b)
 {
     SDL_SetRenderDrawColor(renderer, r, g, b, 255);
-    SDL_RenderClear(renderer);
+
+    // RenderClear ignores the clip rectangle, so inside the back buffer
+    // only the region being repainted is filled
+    if (back_buffer_bound)
+    {
+        SDL_BlendMode mode;
+        SDL_GetRenderDrawBlendMode(renderer, &mode);
+        SDL_SetRenderDrawBlendMode(renderer, SDL_BLENDMODE_NONE);
+        SDL_RenderFillRect(renderer, NULL);
+        SDL_SetRenderDrawBlendMode(renderer, mode);
+    }
+    else
+    {
+        SDL_RenderClear(renderer);
+    }
+}
+
+bool display_is_headless(void)
+{
+    return display_mode != DISPLAY_MODE_WINDOW;
+}
+
+bool display_set_vsync(bool enabled)
+{
+    // Nothing to synchronise with offscreen: vsync is never on
+    if (display_is_headless())
+        return false;
+
+    if (SDL_RenderSetVSync(renderer, enabled ? 1 : 0) < 0)
+    {
+        printf("Could not %s vsync: %s\n", enabled ? "enable" : "disable", SDL_GetError());
+        return false;
+    }
+    return true;
+}
+
+int display_get_refresh_rate(void)
+{
+    SDL_DisplayMode mode;
+    if (!window || SDL_GetWindowDisplayMode(window, &mode) < 0)
+        return 0;
+    return mode.refresh_rate;
+}
+
+// ----------------------------------------------------
+// Damage tracking
+// ----------------------------------------------------
+void display_set_damage_cell(int cell_size)
+{
+    if (cell_size <= 0)
+        return;
+
+    damage_cell = cell_size;
+    damage_cols = (logical_w + cell_size - 1) / cell_size;
+    damage_rows = (logical_h + cell_size - 1) / cell_size;
+    if (damage_cols > DAMAGE_MAX_COLS)
+        damage_cols = DAMAGE_MAX_COLS;
+    if (damage_rows > DAMAGE_MAX_ROWS)
+        damage_rows = DAMAGE_MAX_ROWS;
+
+    display_damage_all();
+}
+
+void display_damage_rect(const SDL_Rect *rect)
+{
+    if (!rect || rect->w <= 0 || rect->h <= 0 || damage_cols == 0)
+        return;
+
+    int x0 = rect->x / damage_cell;
+    int y0 = rect->y / damage_cell;
+    int x1 = (rect->x + rect->w - 1) / damage_cell;
+    int y1 = (rect->y + rect->h - 1) / damage_cell;
+
+    if (x0 < 0) x0 = 0;
+    if (y0 < 0) y0 = 0;
+    if (x1 >= damage_cols) x1 = damage_cols - 1;
+    if (y1 >= damage_rows) y1 = damage_rows - 1;
+
+    for (int y = y0; y <= y1; y++)
+        for (int x = x0; x <= x1; x++)
+            damage_cells[y][x] = true;
+}
+
+void display_damage_all(void)
+{
+    damage_everything = true;
+}
+
+static long rect_area(const SDL_Rect *r)
+{
+    return (long)r->w * (long)r->h;
+}
+
+// Every region costs a full pass over the scene on the CPU, so a few
+// scattered regions are cheaper drawn as their union, and at most
+// DAMAGE_MAX_REGIONS are handed out: the pair whose union adds the least
+// area is merged until the count fits. Overlapping regions are fine, each
+// pass repaints its whole region.
+static int merge_damage_rects(int count)
+{
+    if (count <= 1)
+        return count;
+
+    long damaged = 0;
+    SDL_Rect all = damage_rects[0];
+    for (int i = 0; i < count; i++)
+    {
+        damaged += rect_area(&damage_rects[i]);
+        SDL_UnionRect(&all, &damage_rects[i], &all);
+    }
+
+    if (rect_area(&all) <= damaged * DAMAGE_UNION_SLACK)
+    {
+        damage_rects[0] = all;
+        return 1;
+    }
+
+    while (count > DAMAGE_MAX_REGIONS)
+    {
+        int best_a = 0;
+        int best_b = 1;
+        long best_growth = LONG_MAX; // negative for overlapping pairs
+        for (int a = 0; a < count; a++)
+        {
+            for (int b = a + 1; b < count; b++)
+            {
+                SDL_Rect u;
+                SDL_UnionRect(&damage_rects[a], &damage_rects[b], &u);
+                long growth = rect_area(&u) - rect_area(&damage_rects[a]) - rect_area(&damage_rects[b]);
+                if (growth < best_growth)
+                {
+                    best_growth = growth;
+                    best_a = a;
+                    best_b = b;
+                }
+            }
+        }
+
+        SDL_UnionRect(&damage_rects[best_a], &damage_rects[best_b], &damage_rects[best_a]);
+        damage_rects[best_b] = damage_rects[--count];
+    }
+    return count;
+}
+
+// turns the damaged cells into rectangles: runs of cells per row, merged
+// downwards while the run below covers exactly the same columns
+static int build_damage_rects(void)
+{
+    int count = 0;
+    int dirty = 0;
+
+    if (!damage_everything)
+    {
+        for (int y = 0; y < damage_rows; y++)
+        {
+            int x = 0;
+            while (x < damage_cols)
+            {
+                if (!damage_cells[y][x])
+                {
+                    x++;
+                    continue;
+                }
+
+                int start = x;
+                while (x < damage_cols && damage_cells[y][x])
+                    x++;
+                dirty += x - start;
+
+                SDL_Rect run = {start * damage_cell, y * damage_cell,
+                                (x - start) * damage_cell, damage_cell};
+
+                bool merged = false;
+                for (int i = 0; i < count; i++)
+                {
+                    SDL_Rect *r = &damage_rects[i];
+                    if (r->x == run.x && r->w == run.w && r->y + r->h == run.y)
+                    {
+                        r->h += damage_cell;
+                        merged = true;
+                        break;
+                    }
+                }
+
+                if (merged)
+                    continue;
+
+                if (count == DAMAGE_MAX_RECTS)
+                {
+                    damage_everything = true;
+                    break;
+                }
+                damage_rects[count++] = run;
+            }
+        }
+
+        if (dirty * 100 > damage_cols * damage_rows * DAMAGE_FULL_PERCENT)
+            damage_everything = true;
+    }
+
+    if (damage_everything)
+    {
+        damage_rects[0] = (SDL_Rect){0, 0, logical_w, logical_h};
+        return 1;
+    }
+
+    // clamp the last row/column of cells to the screen
+    for (int i = 0; i < count; i++)
+    {
+        SDL_Rect screen = {0, 0, logical_w, logical_h};
+        SDL_IntersectRect(&damage_rects[i], &screen, &damage_rects[i]);
+    }
+    return merge_damage_rects(count);
+}
+
+static bool ensure_back_buffer(void)
+{
+    if (back_buffer)
+        return true;
+
+    if (!SDL_RenderTargetSupported(renderer))
+        return false;
+
+    SDL_RenderGetScale(renderer, &back_scale_x, &back_scale_y);
+    if (back_scale_x <= 0.0f || back_scale_y <= 0.0f)
+        back_scale_x = back_scale_y = 1.0f;
+
+    int w = (int)(logical_w * back_scale_x + 0.5f);
+    int h = (int)(logical_h * back_scale_y + 0.5f);
+
+    back_buffer = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_ARGB8888,
+                                    SDL_TEXTUREACCESS_TARGET, w, h);
+    if (!back_buffer)
+    {
+        printf("Back buffer could not be created: %s\n", SDL_GetError());
+        return false;
+    }
+    SDL_SetTextureBlendMode(back_buffer, SDL_BLENDMODE_NONE);
+    residency_track(back_buffer);
+
+    printf("Display: %dx%d back buffer for partial updates\n", w, h);
+    damage_everything = true;
+    return true;
+}
+
+int display_begin_frame(const SDL_Rect **regions)
+{
+    int count;
+
+    if (display_mode == DISPLAY_MODE_HEADLESS_NULL)
+    {
+        // Damage is tracked for the statistics, but nothing is drawn
+        back_buffer_bound = false;
+        count = build_damage_rects();
+    }
+    else if (ensure_back_buffer() && SDL_SetRenderTarget(renderer, back_buffer) == 0)
+    {
+        SDL_RenderSetScale(renderer, back_scale_x, back_scale_y);
+        back_buffer_bound = true;
+        count = build_damage_rects();
+    }
+    else
+    {
+        // No back buffer: every frame is a full redraw
+        back_buffer_bound = false;
+        damage_everything = true;
+        count = build_damage_rects();
+    }
+
+    long area = 0;
+    for (int i = 0; i < count; i++)
+        area += (long)damage_rects[i].w * damage_rects[i].h;
+
+    repaint_stats.frames++;
+    if (damage_everything)
+        repaint_stats.full_frames++;
+    repaint_stats.last_rect_count = count;
+    repaint_stats.last_area = area;
+    repaint_stats.total_area += (unsigned long long)area;
+    repaint_stats.frame_area = (long)logical_w * logical_h;
+
+    // Damage is consumed; the next frame starts clean
+    memset(damage_cells, 0, sizeof(damage_cells));
+    damage_everything = false;
+
+    if (regions)
+        *regions = damage_rects;
+    return display_mode == DISPLAY_MODE_HEADLESS_NULL ? 0 : count;
+}
+
+void display_get_repaint_stats(DisplayRepaintStats *out)
+{
+    if (out)
+        *out = repaint_stats;
+}
+
+// ----------------------------------------------------
+// Render target stack
+// ----------------------------------------------------
+bool display_push_target(SDL_Texture *target)
+{
+    if (target_depth >= TARGET_STACK_DEPTH)
+        return false;
+
+    TargetState *state = &target_stack[target_depth];
+    state->target = SDL_GetRenderTarget(renderer);
+    SDL_RenderGetScale(renderer, &state->scale_x, &state->scale_y);
+    state->clip_enabled = SDL_RenderIsClipEnabled(renderer);
+    SDL_RenderGetClipRect(renderer, &state->clip);
+
+    if (SDL_SetRenderTarget(renderer, target) < 0)
+        return false;
+
+    target_depth++;
+    return true;
+}
+
+void display_pop_target(void)
+{
+    if (target_depth == 0)
+        return;
+
+    TargetState *state = &target_stack[--target_depth];
+
+    // Binding a target resets scale and clipping, so both are restored
+    SDL_SetRenderTarget(renderer, state->target);
+    if (state->target)
+        SDL_RenderSetScale(renderer, state->scale_x, state->scale_y);
+    SDL_RenderSetClipRect(renderer, state->clip_enabled ? &state->clip : NULL);
+}
+
+// ----------------------------------------------------
+// Input latency
+// ----------------------------------------------------
+static uint64_t monotonic_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+void display_mark_input(unsigned long input_id, uint64_t input_ns)
+{
+    if (input_id == 0 || input_ns == 0)
+        return;
+
+    if (pending_input_id == 0 || input_ns < pending_input_ns)
+    {
+        pending_input_id = input_id;
+        pending_input_ns = input_ns;
+    }
+}
+
+// called once the frame carrying the pending input is on its way out
+static void record_input_latency(void)
+{
+    if (pending_input_id == 0)
+        return;
+
+    uint64_t now = monotonic_ns();
+    double ms = now > pending_input_ns ? (double)(now - pending_input_ns) / 1e6 : 0.0;
+    printf("Display: input %lu presented after %.1f ms\n", pending_input_id, ms);
+
+    latency_ms[latency_head] = ms;
+    latency_head = (latency_head + 1) % LATENCY_HISTORY;
+    if (latency_count < LATENCY_HISTORY)
+        latency_count++;
+    latency_inputs++;
+    pending_input_id = 0;
+}
+
+static int compare_double(const void *a, const void *b)
+{
+    double da = *(const double *)a;
+    double db = *(const double *)b;
+    return (da > db) - (da < db);
+}
+
+// value below which percent of the sorted values fall
+static double percentile(const double *sorted, int count, int percent)
+{
+    int index = (count * percent) / 100;
+    if (index >= count)
+        index = count - 1;
+    return sorted[index];
+}
+
+void display_get_latency_stats(DisplayLatencyStats *out)
+{
+    if (!out)
+        return;
+
+    memset(out, 0, sizeof(*out));
+    out->inputs = latency_inputs;
+    out->history = latency_count;
+    if (latency_count == 0)
+        return;
+
+    double sorted[LATENCY_HISTORY];
+    memcpy(sorted, latency_ms, sizeof(sorted[0]) * latency_count);
+    qsort(sorted, latency_count, sizeof(sorted[0]), compare_double);
+
+    out->p50_ms = percentile(sorted, latency_count, 50);
+    out->p95_ms = percentile(sorted, latency_count, 95);
+    out->p99_ms = percentile(sorted, latency_count, 99);
+    out->worst_ms = sorted[latency_count - 1];
 }
 
 void display_present(void)
 {
-    SDL_RenderPresent(renderer);
-}
\ No newline at end of file
+    if (back_buffer_bound)
+    {
+        SDL_RenderSetClipRect(renderer, NULL);
+        SDL_SetRenderTarget(renderer, NULL);
+        back_buffer_bound = false;
+
+        // The window's buffers are not preserved across presents, so the
+        // whole back buffer is copied out; only its damaged parts were redrawn
+        SDL_SetRenderDrawColor(renderer, 0, 0, 0, 255);
+        SDL_RenderClear(renderer);
+        SDL_RenderCopy(renderer, back_buffer, NULL, NULL);
+    }
+
+    // With vsync this returns once the frame is queued for scan-out, so
+    // the measured time stops at the flip rather than at the first photon
+    // (null mode never draws, so there is nothing to show)
+    if (display_mode != DISPLAY_MODE_HEADLESS_NULL)
+        SDL_RenderPresent(renderer);
+    record_input_latency();
+}
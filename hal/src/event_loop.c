@@ -0,0 +1,243 @@
+#define _POSIX_C_SOURCE 200809L
+#include "event_loop.h"
+#include <SDL2/SDL.h>
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/timerfd.h>
+
+#define NSEC_PER_SEC 1000000000LL
+#define MAX_WATCHED 32
+#define INPUT_DEVICE_DIR "/dev/input"
+
+typedef struct
+{
+    int fd;
+    bool drain;
+    bool owned; // input device opened here, closed at cleanup
+} WatchedFd;
+
+static int epoll_fd = -1;
+static int timer_fd = -1;
+static int wake_fd = -1;
+
+static WatchedFd watched[MAX_WATCHED];
+static int watched_count = 0;
+
+static EventLoopStats stats;
+
+static long long now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long long)ts.tv_sec * NSEC_PER_SEC + ts.tv_nsec;
+}
+
+// reads a non-blocking descriptor until it is empty
+static void drain_fd(int fd)
+{
+    char buffer[256];
+    while (read(fd, buffer, sizeof(buffer)) > 0)
+    {
+    }
+}
+
+// the epoll data of a descriptor is its index in watched[]
+static bool add_watch(int fd, bool drain, bool owned)
+{
+    if (fd < 0 || epoll_fd < 0)
+        return false;
+
+    if (watched_count >= MAX_WATCHED)
+    {
+        fprintf(stderr, "Event loop: Too many descriptors\n");
+        return false;
+    }
+
+    struct epoll_event ev;
+    memset(&ev, 0, sizeof(ev));
+    ev.events = EPOLLIN;
+    ev.data.u32 = (uint32_t)watched_count;
+    if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, fd, &ev) != 0)
+    {
+        perror("Event loop: epoll_ctl");
+        return false;
+    }
+
+    watched[watched_count].fd = fd;
+    watched[watched_count].drain = drain;
+    watched[watched_count].owned = owned;
+    watched_count++;
+    return true;
+}
+
+// SDL calls this for every event it queues, on the thread queueing it
+static int wake_on_event(void *userdata, SDL_Event *event)
+{
+    (void)userdata;
+    (void)event;
+    event_loop_wake();
+    return 1;
+}
+
+bool event_loop_init(void)
+{
+    memset(&stats, 0, sizeof(stats));
+    watched_count = 0;
+
+    epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    timer_fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+    wake_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (epoll_fd < 0 || timer_fd < 0 || wake_fd < 0)
+    {
+        perror("Event loop: init");
+        event_loop_cleanup();
+        return false;
+    }
+
+    if (!add_watch(timer_fd, true, false) || !add_watch(wake_fd, true, false))
+    {
+        event_loop_cleanup();
+        return false;
+    }
+
+    // Events pushed from other threads (or a quit request) end a wait;
+    // window-system events are only queued once the main thread pumps
+    SDL_AddEventWatch(wake_on_event, NULL);
+    return true;
+}
+
+bool event_loop_watch_fd(int fd, bool drain)
+{
+    return add_watch(fd, drain, false);
+}
+
+int event_loop_watch_input_devices(void)
+{
+    DIR *dir = opendir(INPUT_DEVICE_DIR);
+    if (!dir)
+        return 0;
+
+    int opened = 0;
+    struct dirent *ent;
+    while ((ent = readdir(dir)) != NULL)
+    {
+        if (strncmp(ent->d_name, "event", 5) != 0)
+            continue;
+
+        // Every open evdev descriptor gets its own copy of the events, so
+        // reading ours empty does not take anything away from SDL
+        char path[300];
+        snprintf(path, sizeof(path), "%s/%s", INPUT_DEVICE_DIR, ent->d_name);
+        int fd = open(path, O_RDONLY | O_NONBLOCK | O_CLOEXEC);
+        if (fd < 0)
+            continue;
+
+        if (add_watch(fd, true, true))
+            opened++;
+        else
+            close(fd);
+    }
+
+    closedir(dir);
+    return opened;
+}
+
+void event_loop_wake(void)
+{
+    if (wake_fd < 0)
+        return;
+
+    uint64_t one = 1;
+    if (write(wake_fd, &one, sizeof(one)) < 0)
+    {
+        // counter full: a wakeup is pending anyway
+    }
+}
+
+bool event_loop_wait_until(long long deadline_ns)
+{
+    if (epoll_fd < 0)
+        return false;
+
+    long long start = now_ns();
+    if (deadline_ns <= start)
+        return false;
+
+    struct itimerspec timer;
+    memset(&timer, 0, sizeof(timer));
+    timer.it_value.tv_sec = deadline_ns / NSEC_PER_SEC;
+    timer.it_value.tv_nsec = deadline_ns % NSEC_PER_SEC;
+    timerfd_settime(timer_fd, TFD_TIMER_ABSTIME, &timer, NULL);
+
+    struct epoll_event events[MAX_WATCHED];
+    int count;
+    do
+    {
+        count = epoll_wait(epoll_fd, events, MAX_WATCHED, -1);
+    } while (count < 0 && errno == EINTR && now_ns() < deadline_ns);
+
+    bool input = false;
+    for (int i = 0; i < count; i++)
+    {
+        WatchedFd *w = &watched[events[i].data.u32];
+        if (w->fd != timer_fd)
+            input = true;
+        if (w->drain)
+            drain_fd(w->fd);
+    }
+
+    // disarm, so a deadline that passes during the frame does not linger
+    memset(&timer, 0, sizeof(timer));
+    timerfd_settime(timer_fd, 0, &timer, NULL);
+    drain_fd(timer_fd);
+
+    stats.waits++;
+    if (input)
+        stats.input_wakeups++;
+    else
+        stats.timer_wakeups++;
+    stats.waited_ms += (now_ns() - start) / 1e6;
+    return input;
+}
+
+void event_loop_get_stats(EventLoopStats *out)
+{
+    if (out)
+        *out = stats;
+}
+
+void event_loop_cleanup(void)
+{
+    if (epoll_fd >= 0 && stats.waits > 0)
+    {
+        printf("Event loop: %lu waits (%lu woken by input, %lu by timer), %.1f s asleep\n",
+               stats.waits, stats.input_wakeups, stats.timer_wakeups, stats.waited_ms / 1000.0);
+    }
+
+    SDL_DelEventWatch(wake_on_event, NULL);
+
+    for (int i = 0; i < watched_count; i++)
+    {
+        if (watched[i].owned)
+            close(watched[i].fd);
+    }
+    watched_count = 0;
+
+    if (timer_fd >= 0)
+        close(timer_fd);
+    if (wake_fd >= 0)
+        close(wake_fd);
+    if (epoll_fd >= 0)
+        close(epoll_fd);
+    epoll_fd = -1;
+    timer_fd = -1;
+    wake_fd = -1;
+}
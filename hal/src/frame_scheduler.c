@@ -0,0 +1,223 @@
+#define _POSIX_C_SOURCE 200809L
+#include "frame_scheduler.h"
+#include "event_loop.h"
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include <errno.h>
+
+#define NSEC_PER_SEC 1000000000LL
+#define STATS_WINDOW 120 // frames kept for fps/jitter
+
+static FrameMode frame_mode = FRAME_MODE_FIXED;
+static long long frame_period_ns = NSEC_PER_SEC / 30;
+static long long refresh_period_ns = 0;
+
+static long long next_deadline_ns = 0; // absolute, CLOCK_MONOTONIC
+static long long last_frame_ns = 0;
+
+static long long frame_times_ns[STATS_WINDOW];
+static int frame_time_count = 0;
+static int frame_time_head = 0;
+
+static unsigned long total_frames = 0;
+static unsigned long missed_frames = 0;
+static unsigned long idle_frames = 0;
+
+static long long now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long long)ts.tv_sec * NSEC_PER_SEC + ts.tv_nsec;
+}
+
+// sleeps until an absolute CLOCK_MONOTONIC time, immune to oversleep drift
+static void sleep_until(long long deadline_ns)
+{
+    struct timespec ts;
+    ts.tv_sec = deadline_ns / NSEC_PER_SEC;
+    ts.tv_nsec = deadline_ns % NSEC_PER_SEC;
+
+    while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL) == EINTR)
+    {
+        // interrupted by a signal: the deadline is absolute, just retry
+    }
+}
+
+static void record_frame_time(long long frame_ns)
+{
+    frame_times_ns[frame_time_head] = frame_ns;
+    frame_time_head = (frame_time_head + 1) % STATS_WINDOW;
+    if (frame_time_count < STATS_WINDOW)
+        frame_time_count++;
+}
+
+bool frame_scheduler_init(FrameMode mode, int target_fps, int refresh_hz)
+{
+    if (target_fps <= 0)
+    {
+        fprintf(stderr, "Frame scheduler: Invalid target rate %d\n", target_fps);
+        return false;
+    }
+
+    frame_period_ns = NSEC_PER_SEC / target_fps;
+    refresh_period_ns = refresh_hz > 0 ? NSEC_PER_SEC / refresh_hz : 0;
+
+    frame_time_count = 0;
+    frame_time_head = 0;
+    total_frames = 0;
+    missed_frames = 0;
+    idle_frames = 0;
+
+    frame_scheduler_set_mode(mode);
+
+    printf("Frame scheduler: %s mode, %d fps target, %d Hz display\n",
+           frame_scheduler_mode_name(mode), target_fps, refresh_hz);
+    return true;
+}
+
+void frame_scheduler_set_mode(FrameMode mode)
+{
+    frame_mode = mode;
+
+    // restart the deadline sequence from now
+    last_frame_ns = now_ns();
+    next_deadline_ns = last_frame_ns + frame_period_ns;
+}
+
+FrameMode frame_scheduler_get_mode(void)
+{
+    return frame_mode;
+}
+
+void frame_scheduler_end_frame(void)
+{
+    long long now = now_ns();
+
+    if (frame_mode == FRAME_MODE_FIXED)
+    {
+        if (now > next_deadline_ns)
+        {
+            // Work overran the slot: count the deadlines that were skipped
+            // and re-anchor instead of racing to catch up
+            long long late = now - next_deadline_ns;
+            missed_frames += (unsigned long)(late / frame_period_ns) + 1;
+            next_deadline_ns = now + frame_period_ns - (late % frame_period_ns);
+        }
+        else
+        {
+            // The deadline is absolute, so the time already spent on this
+            // frame's work is subtracted automatically
+            sleep_until(next_deadline_ns);
+            next_deadline_ns += frame_period_ns;
+        }
+        now = now_ns();
+    }
+    else if (frame_mode == FRAME_MODE_VSYNC && refresh_period_ns > 0)
+    {
+        // present blocked on the refresh; a frame spanning more than one
+        // and a half refresh periods missed at least one vblank
+        long long frame_ns = now - last_frame_ns;
+        if (frame_ns > refresh_period_ns + refresh_period_ns / 2)
+            missed_frames += (unsigned long)((frame_ns - refresh_period_ns / 2) / refresh_period_ns);
+    }
+
+    record_frame_time(now - last_frame_ns);
+    last_frame_ns = now;
+    total_frames++;
+}
+
+void frame_scheduler_end_idle_frame(int max_wait_ms)
+{
+    // Nothing to show until something happens: sleep on the event loop,
+    // then start the deadline sequence over from the wakeup. The idle
+    // stretch is neither a frame time nor a missed deadline.
+    event_loop_wait_until(now_ns() + (long long)max_wait_ms * 1000000LL);
+
+    last_frame_ns = now_ns();
+    next_deadline_ns = last_frame_ns + frame_period_ns;
+    idle_frames++;
+    total_frames++;
+}
+
+void frame_scheduler_get_stats(FrameStats *stats)
+{
+    if (!stats)
+        return;
+
+    memset(stats, 0, sizeof(*stats));
+    stats->frames = total_frames;
+    stats->missed_frames = missed_frames;
+    stats->idle_frames = idle_frames;
+
+    if (frame_time_count == 0)
+        return;
+
+    double sum = 0.0;
+    double worst = 0.0;
+    for (int i = 0; i < frame_time_count; i++)
+    {
+        double ms = frame_times_ns[i] / 1e6;
+        sum += ms;
+        if (ms > worst)
+            worst = ms;
+    }
+    double mean = sum / frame_time_count;
+
+    double variance = 0.0;
+    for (int i = 0; i < frame_time_count; i++)
+    {
+        double d = frame_times_ns[i] / 1e6 - mean;
+        variance += d * d;
+    }
+    variance /= frame_time_count;
+
+    stats->average_ms = mean;
+    stats->fps = mean > 0.0 ? 1000.0 / mean : 0.0;
+    stats->jitter_ms = sqrt(variance);
+    stats->worst_ms = worst;
+}
+
+bool frame_scheduler_parse_mode(const char *name, FrameMode *mode)
+{
+    if (!name || !mode)
+        return false;
+
+    if (strcmp(name, "vsync") == 0)
+        *mode = FRAME_MODE_VSYNC;
+    else if (strcmp(name, "fixed") == 0)
+        *mode = FRAME_MODE_FIXED;
+    else if (strcmp(name, "uncapped") == 0)
+        *mode = FRAME_MODE_UNCAPPED;
+    else
+        return false;
+
+    return true;
+}
+
+const char *frame_scheduler_mode_name(FrameMode mode)
+{
+    switch (mode)
+    {
+    case FRAME_MODE_VSYNC:
+        return "vsync";
+    case FRAME_MODE_FIXED:
+        return "fixed";
+    case FRAME_MODE_UNCAPPED:
+        return "uncapped";
+    }
+    return "unknown";
+}
+
+void frame_scheduler_cleanup(void)
+{
+    FrameStats stats;
+    frame_scheduler_get_stats(&stats);
+
+    if (stats.frames == 0)
+        return;
+
+    printf("Frame scheduler: %lu frames (%lu idle), %lu missed, %.1f fps, %.2f ms jitter, %.1f ms worst\n",
+           stats.frames, stats.idle_frames, stats.missed_frames, stats.fps, stats.jitter_ms, stats.worst_ms);
+}
@@ -0,0 +1,457 @@
+#include "image.h"
+#include "asset_pack.h"
+#include <SDL2/SDL_image.h>
+#include <stdio.h>
+#include <string.h>
+
+#define IMAGE_BLOB_MAGIC "STEX"
+#define IMAGE_BLOB_VERSION 1
+#define IMAGE_BLOB_PREMULTIPLIED 0x1u
+#define IMAGE_PATH_MAX 256
+
+#define IMAGE_PRELOAD_MAX 64
+
+// Texture blob header, little-endian, followed by height rows of pitch bytes
+typedef struct {
+    char magic[4];
+    Uint16 version;
+    Uint16 header_size;
+    Uint32 width;
+    Uint32 height;
+    Uint32 pitch;
+    Uint32 format;         // SDL_PIXELFORMAT_*
+    Uint32 flags;
+    Uint32 reserved;
+} ImageBlobHeader;
+
+// Images handed over by the asset loader, waiting for their first use
+typedef struct {
+    char path[IMAGE_PATH_MAX];
+    SDL_Surface* surface;      // decoded source image, or
+    SDL_Texture* texture;      // texture already fitted to logical_w x logical_h
+    int logical_w;
+    int logical_h;
+} PreloadedImage;
+
+static PreloadedImage preloaded[IMAGE_PRELOAD_MAX];
+static int preloaded_count = 0;
+
+// x * a / 255 for every colour byte, two channels per 32-bit lane. Alpha
+// sits in the top byte for both ARGB8888 and ABGR8888.
+static void premultiply_surface(SDL_Surface* surface) {
+    for (int y = 0; y < surface->h; y++) {
+        Uint32* row = (Uint32*)((Uint8*)surface->pixels + y * surface->pitch);
+
+        for (int x = 0; x < surface->w; x++) {
+            Uint32 p = row[x];
+            Uint32 a = p >> 24;
+            if (a == 0xFF) {
+                continue;
+            }
+
+            Uint32 rb = (p & 0x00FF00FF) * a + 0x00800080;
+            rb = ((rb + ((rb >> 8) & 0x00FF00FF)) >> 8) & 0x00FF00FF;
+            Uint32 g = (p & 0x0000FF00) * a + 0x00008000;
+            g = ((g + ((g >> 8) & 0x0000FF00)) >> 8) & 0x0000FF00;
+
+            row[x] = (p & 0xFF000000) | rb | g;
+        }
+    }
+}
+
+// Inverse of premultiply_surface, only used for renderers that cannot blend
+// premultiplied textures
+static void unpremultiply_surface(SDL_Surface* surface) {
+    for (int y = 0; y < surface->h; y++) {
+        Uint32* row = (Uint32*)((Uint8*)surface->pixels + y * surface->pitch);
+
+        for (int x = 0; x < surface->w; x++) {
+            Uint32 p = row[x];
+            Uint32 a = p >> 24;
+            if (a == 0xFF || a == 0) {
+                continue;
+            }
+
+            Uint32 out = p & 0xFF000000;
+            for (int shift = 0; shift < 24; shift += 8) {
+                Uint32 c = (((p >> shift) & 0xFF) * 255 + a / 2) / a;
+                out |= (c > 255 ? 255 : c) << shift;
+            }
+            row[x] = out;
+        }
+    }
+}
+
+static SDL_Surface* to_native_format(SDL_Surface* surface, const char* path) {
+    if (surface->format->format == IMAGE_NATIVE_FORMAT) {
+        return surface;
+    }
+
+    SDL_Surface* converted = SDL_ConvertSurfaceFormat(surface, IMAGE_NATIVE_FORMAT, 0);
+    SDL_FreeSurface(surface);
+    if (!converted) {
+        fprintf(stderr, "Image: Failed to convert '%s': %s\n", path, SDL_GetError());
+    }
+    return converted;
+}
+
+SDL_Surface* image_decode_file(const char* path) {
+    SDL_RWops* rw = asset_open(path);
+    SDL_Surface* loaded = rw ? IMG_Load_RW(rw, 1) : NULL;
+    if (!loaded) {
+        fprintf(stderr, "Image: Failed to load '%s': %s\n", path, IMG_GetError());
+        return NULL;
+    }
+
+    SDL_Surface* surface = to_native_format(loaded, path);
+    if (surface) {
+        premultiply_surface(surface);
+    }
+    return surface;
+}
+
+SDL_Surface* image_load_blob(const char* path) {
+    SDL_RWops* rw = asset_open(path);
+    if (!rw) {
+        return NULL;
+    }
+
+    ImageBlobHeader header;
+    if (SDL_RWread(rw, &header, sizeof(header), 1) != 1 ||
+        memcmp(header.magic, IMAGE_BLOB_MAGIC, 4) != 0 ||
+        SDL_SwapLE16(header.version) != IMAGE_BLOB_VERSION) {
+        fprintf(stderr, "Image: '%s' is not a texture blob\n", path);
+        SDL_RWclose(rw);
+        return NULL;
+    }
+
+    int w = (int)SDL_SwapLE32(header.width);
+    int h = (int)SDL_SwapLE32(header.height);
+    int pitch = (int)SDL_SwapLE32(header.pitch);
+    Uint32 format = SDL_SwapLE32(header.format);
+    Uint32 flags = SDL_SwapLE32(header.flags);
+    Sint64 data_offset = SDL_SwapLE16(header.header_size);
+
+    SDL_Surface* surface = NULL;
+    if (w > 0 && h > 0 && SDL_BYTESPERPIXEL(format) == 4 && pitch >= w * 4 &&
+        SDL_RWseek(rw, data_offset, RW_SEEK_SET) == data_offset) {
+        surface = SDL_CreateRGBSurfaceWithFormat(0, w, h, 32, format);
+    }
+    if (!surface) {
+        fprintf(stderr, "Image: Bad texture blob '%s'\n", path);
+        SDL_RWclose(rw);
+        return NULL;
+    }
+
+    // Rows go straight into the surface (a plain copy out of a mapped
+    // pack): there is nothing to decode
+    bool ok = true;
+    if (pitch == surface->pitch) {
+        ok = SDL_RWread(rw, surface->pixels, (size_t)pitch * h, 1) == 1;
+    } else {
+        for (int y = 0; y < h && ok; y++) {
+            ok = SDL_RWread(rw, (Uint8*)surface->pixels + y * surface->pitch, (size_t)w * 4, 1) == 1 &&
+                 SDL_RWseek(rw, pitch - w * 4, RW_SEEK_CUR) >= 0;
+        }
+    }
+    SDL_RWclose(rw);
+
+    if (!ok) {
+        fprintf(stderr, "Image: Truncated texture blob '%s'\n", path);
+        SDL_FreeSurface(surface);
+        return NULL;
+    }
+
+    surface = to_native_format(surface, path);
+    if (surface && !(flags & IMAGE_BLOB_PREMULTIPLIED)) {
+        premultiply_surface(surface);
+    }
+    return surface;
+}
+
+bool image_write_blob(const char* path, SDL_Surface* surface) {
+    if (!path || !surface || surface->format->format != IMAGE_NATIVE_FORMAT) {
+        return false;
+    }
+
+    ImageBlobHeader header;
+    memcpy(header.magic, IMAGE_BLOB_MAGIC, 4);
+    header.version = SDL_SwapLE16(IMAGE_BLOB_VERSION);
+    header.header_size = SDL_SwapLE16((Uint16)sizeof(header));
+    header.width = SDL_SwapLE32((Uint32)surface->w);
+    header.height = SDL_SwapLE32((Uint32)surface->h);
+    header.pitch = SDL_SwapLE32((Uint32)surface->w * 4);
+    header.format = SDL_SwapLE32(IMAGE_NATIVE_FORMAT);
+    header.flags = SDL_SwapLE32(IMAGE_BLOB_PREMULTIPLIED);
+    header.reserved = 0;
+
+    FILE* file = fopen(path, "wb");
+    if (!file) {
+        fprintf(stderr, "Image: Cannot write '%s'\n", path);
+        return false;
+    }
+
+    bool ok = fwrite(&header, sizeof(header), 1, file) == 1;
+    for (int y = 0; y < surface->h && ok; y++) {
+        const Uint8* row = (const Uint8*)surface->pixels + y * surface->pitch;
+        ok = fwrite(row, (size_t)surface->w * 4, 1, file) == 1;
+    }
+
+    if (fclose(file) != 0 || !ok) {
+        fprintf(stderr, "Image: Failed writing '%s'\n", path);
+        remove(path);
+        return false;
+    }
+    return true;
+}
+
+SDL_Surface* image_read_surface(const char* path) {
+    char blob_path[IMAGE_PATH_MAX];
+    snprintf(blob_path, sizeof(blob_path), "%s%s", path, IMAGE_BLOB_SUFFIX);
+
+    SDL_Surface* surface = image_load_blob(blob_path);
+    if (surface) {
+        return surface;
+    }
+    return image_decode_file(path);
+}
+
+// finds a preloaded image; textures also have to match the logical size
+static int find_preloaded(const char* path, bool texture, int logical_w, int logical_h) {
+    for (int i = 0; i < preloaded_count; i++) {
+        PreloadedImage* p = &preloaded[i];
+        if ((p->texture != NULL) != texture || strcmp(p->path, path) != 0) {
+            continue;
+        }
+        if (!texture || (p->logical_w == logical_w && p->logical_h == logical_h)) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+static void remove_preloaded(int index) {
+    preloaded[index] = preloaded[--preloaded_count];
+}
+
+static PreloadedImage* add_preloaded(const char* path) {
+    if (preloaded_count >= IMAGE_PRELOAD_MAX) {
+        fprintf(stderr, "Image: Preload table full, dropping '%s'\n", path);
+        return NULL;
+    }
+    PreloadedImage* p = &preloaded[preloaded_count++];
+    memset(p, 0, sizeof(*p));
+    snprintf(p->path, sizeof(p->path), "%s", path);
+    return p;
+}
+
+bool image_preload_surface(const char* path, SDL_Surface* surface) {
+    PreloadedImage* p = add_preloaded(path);
+    if (!p) {
+        return false;
+    }
+    p->surface = surface;
+    return true;
+}
+
+bool image_preload_texture(const char* path, int logical_w, int logical_h, SDL_Texture* texture) {
+    PreloadedImage* p = add_preloaded(path);
+    if (!p) {
+        return false;
+    }
+    p->texture = texture;
+    p->logical_w = logical_w;
+    p->logical_h = logical_h;
+    return true;
+}
+
+void image_preload_clear(void) {
+    for (int i = 0; i < preloaded_count; i++) {
+        if (preloaded[i].texture) {
+            SDL_DestroyTexture(preloaded[i].texture);
+        }
+        if (preloaded[i].surface) {
+            SDL_FreeSurface(preloaded[i].surface);
+        }
+    }
+    preloaded_count = 0;
+}
+
+SDL_Surface* image_load_surface(const char* path) {
+    int index = find_preloaded(path, false, 0, 0);
+    if (index >= 0) {
+        SDL_Surface* surface = preloaded[index].surface;
+        remove_preloaded(index);
+        return surface;
+    }
+    return image_read_surface(path);
+}
+
+SDL_BlendMode image_blend_mode(void) {
+    return SDL_ComposeCustomBlendMode(
+        SDL_BLENDFACTOR_ONE, SDL_BLENDFACTOR_ONE_MINUS_SRC_ALPHA, SDL_BLENDOPERATION_ADD,
+        SDL_BLENDFACTOR_ONE, SDL_BLENDFACTOR_ONE_MINUS_SRC_ALPHA, SDL_BLENDOPERATION_ADD);
+}
+
+SDL_Texture* image_create_texture(SDL_Renderer* renderer, SDL_Surface* surface) {
+    SDL_Texture* texture = SDL_CreateTextureFromSurface(renderer, surface);
+    if (!texture || SDL_SetTextureBlendMode(texture, image_blend_mode()) == 0) {
+        return texture;
+    }
+
+    // The software renderer has no custom blend modes
+    SDL_DestroyTexture(texture);
+    unpremultiply_surface(surface);
+    texture = SDL_CreateTextureFromSurface(renderer, surface);
+    if (texture) {
+        SDL_SetTextureBlendMode(texture, SDL_BLENDMODE_BLEND);
+    }
+    return texture;
+}
+
+// Averages 2x2 blocks. Two channels are summed per 32-bit lane (R/B and A/G),
+// which keeps the inner loop branch-free so the compiler can vectorize it.
+static SDL_Surface* halve_surface(SDL_Surface* src) {
+    int w = src->w / 2;
+    int h = src->h / 2;
+
+    SDL_Surface* dst = SDL_CreateRGBSurfaceWithFormat(0, w, h, 32, IMAGE_NATIVE_FORMAT);
+    if (!dst) {
+        return NULL;
+    }
+
+    for (int y = 0; y < h; y++) {
+        const Uint32* row0 = (const Uint32*)((const Uint8*)src->pixels + (2 * y) * src->pitch);
+        const Uint32* row1 = (const Uint32*)((const Uint8*)src->pixels + (2 * y + 1) * src->pitch);
+        Uint32* out = (Uint32*)((Uint8*)dst->pixels + y * dst->pitch);
+
+        for (int x = 0; x < w; x++) {
+            Uint32 a = row0[2 * x], b = row0[2 * x + 1];
+            Uint32 c = row1[2 * x], d = row1[2 * x + 1];
+
+            Uint32 rb = (a & 0x00FF00FF) + (b & 0x00FF00FF) + (c & 0x00FF00FF) + (d & 0x00FF00FF);
+            Uint32 ag = ((a >> 8) & 0x00FF00FF) + ((b >> 8) & 0x00FF00FF) +
+                        ((c >> 8) & 0x00FF00FF) + ((d >> 8) & 0x00FF00FF);
+
+            rb = ((rb + 0x00020002) >> 2) & 0x00FF00FF;
+            ag = ((ag + 0x00020002) >> 2) & 0x00FF00FF;
+            out[x] = rb | (ag << 8);
+        }
+    }
+
+    return dst;
+}
+
+SDL_Surface* image_scale_surface(SDL_Surface* source, int w, int h) {
+    if (!source || w <= 0 || h <= 0) {
+        return NULL;
+    }
+
+    SDL_Surface* current = source->format->format == IMAGE_NATIVE_FORMAT
+                               ? source
+                               : SDL_ConvertSurfaceFormat(source, IMAGE_NATIVE_FORMAT, 0);
+    if (!current) {
+        return NULL;
+    }
+
+    // Box-filter halving while at least 2x too large: a linear stretch alone
+    // only samples 2x2 texels and would alias on big reductions
+    while (current->w >= 2 * w && current->h >= 2 * h) {
+        SDL_Surface* half = halve_surface(current);
+        if (current != source) {
+            SDL_FreeSurface(current);
+        }
+        if (!half) {
+            return NULL;
+        }
+        current = half;
+    }
+
+    if (current->w == w && current->h == h) {
+        return current != source ? current
+                                 : SDL_ConvertSurfaceFormat(source, IMAGE_NATIVE_FORMAT, 0);
+    }
+
+    SDL_Surface* scaled = SDL_CreateRGBSurfaceWithFormat(0, w, h, 32, IMAGE_NATIVE_FORMAT);
+    if (scaled && SDL_SoftStretchLinear(current, NULL, scaled, NULL) < 0) {
+        fprintf(stderr, "Image: Stretch failed: %s\n", SDL_GetError());
+        SDL_FreeSurface(scaled);
+        scaled = NULL;
+    }
+
+    if (current != source) {
+        SDL_FreeSurface(current);
+    }
+    return scaled;
+}
+
+void image_output_size(SDL_Renderer* renderer, int logical_w, int logical_h, int* out_w, int* out_h) {
+    float sx = 1.0f;
+    float sy = 1.0f;
+    if (renderer) {
+        SDL_RenderGetScale(renderer, &sx, &sy);
+    }
+    if (sx <= 0.0f || sy <= 0.0f) {
+        sx = sy = 1.0f;
+    }
+
+    int w = (int)(logical_w * sx + 0.5f);
+    int h = (int)(logical_h * sy + 0.5f);
+    *out_w = w > 0 ? w : 1;
+    *out_h = h > 0 ? h : 1;
+}
+
+SDL_Surface* image_fit_output(SDL_Renderer* renderer, SDL_Surface* surface, int logical_w, int logical_h) {
+    int w, h;
+    image_output_size(renderer, logical_w, logical_h, &w, &h);
+    return image_fit_size(surface, w, h);
+}
+
+SDL_Surface* image_fit_size(SDL_Surface* surface, int w, int h) {
+    if (!surface) {
+        return NULL;
+    }
+
+    // Never upscale: a smaller source is already as sharp as it gets
+    if (w > surface->w) w = surface->w;
+    if (h > surface->h) h = surface->h;
+    if (w == surface->w && h == surface->h) {
+        return surface;
+    }
+
+    SDL_Surface* scaled = image_scale_surface(surface, w, h);
+    if (!scaled) {
+        return surface;
+    }
+
+    SDL_FreeSurface(surface);
+    return scaled;
+}
+
+SDL_Surface* image_load_for_output(SDL_Renderer* renderer, const char* path, int logical_w, int logical_h) {
+    return image_fit_output(renderer, image_load_surface(path), logical_w, logical_h);
+}
+
+SDL_Texture* image_load_texture(SDL_Renderer* renderer, const char* path, int logical_w, int logical_h) {
+    int index = find_preloaded(path, true, logical_w, logical_h);
+    if (index >= 0) {
+        SDL_Texture* texture = preloaded[index].texture;
+        remove_preloaded(index);
+        return texture;
+    }
+
+    SDL_Surface* surface = image_load_for_output(renderer, path, logical_w, logical_h);
+    if (!surface) {
+        return NULL;
+    }
+
+    SDL_Texture* texture = image_create_texture(renderer, surface);
+    if (!texture) {
+        fprintf(stderr, "Image: Failed to create texture from '%s': %s\n", path, SDL_GetError());
+    } else {
+        printf("Image: Loaded '%s' at %dx%d for %dx%d\n", path, surface->w, surface->h, logical_w, logical_h);
+    }
+
+    SDL_FreeSurface(surface);
+    return texture;
+}
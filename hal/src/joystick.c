@@ -1,8 +1,14 @@
+#define _POSIX_C_SOURCE 200809L
+
 #include "joystick.h"
 #include <stdio.h>
 #include <unistd.h>
 #include <stdint.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include <time.h>
 #include <linux/spi/spidev.h>
+#include <sys/eventfd.h>
 #include <sys/ioctl.h>
 #include <fcntl.h>
 
@@ -10,11 +16,69 @@
 #define SPI_SPEED 1000000
 #define MCP3208_READ_CMD 0x06
 
+// Conversions per channel in one SPI message, averaged into one sample
+#define JOYSTICK_OVERSAMPLE 4
+
+// Samples in the moving average
+#define JOYSTICK_FILTER_TAPS 4
+
+// MCP3208 gives 12-bit values (0-4095), center is ~2048. A direction is
+// entered past ENTER and only released again inside RELEASE, so a stick
+// resting near the threshold does not flicker.
+#define JOYSTICK_CENTER 2048
+#define JOYSTICK_ENTER_THRESHOLD 800
+#define JOYSTICK_RELEASE_THRESHOLD 600
+
+#define JOYSTICK_TRANSFERS (2 * JOYSTICK_OVERSAMPLE)
+
+// Direction changes waiting for joystick_take_change (power of two)
+#define JOYSTICK_CHANGE_QUEUE 16
+
 static int spi_fd = -1;
-static int readChannel(int channel);
 
-// initialize the joystick spi communication
-bool joystick_initialize(void)
+// Counter signalled by the sampler whenever the filtered direction changes
+static int change_fd = -1;
+
+// Sampler thread
+static pthread_t sampler_thread;
+static bool sampler_running = false;
+static atomic_bool sampler_stop;
+static atomic_long sample_period_ns;
+static long initial_period_ns = 0;
+
+// Latest filtered state, published through a seqlock: the sampler makes the
+// sequence odd while it writes, readers retry until they see the same even
+// sequence before and after copying. Readers never block the sampler.
+static atomic_uint state_sequence;
+static atomic_int state_x;
+static atomic_int state_y;
+static atomic_int state_direction;
+static atomic_ulong state_samples;
+static atomic_ullong state_timestamp;
+static atomic_ulong state_changed_sample;
+static atomic_ullong state_changed_ns;
+
+// Direction changes, single producer (sampler) / single consumer. The
+// sampler drops a change when the reader has fallen this far behind.
+static JoystickChange change_queue[JOYSTICK_CHANGE_QUEUE];
+static atomic_uint change_head; // next slot the sampler writes
+static atomic_uint change_tail; // next slot the reader takes
+static unsigned long changes_dropped = 0;
+
+// Moving average (sampler thread only)
+static int filter_x[JOYSTICK_FILTER_TAPS];
+static int filter_y[JOYSTICK_FILTER_TAPS];
+static int filter_sum_x = 0;
+static int filter_sum_y = 0;
+static int filter_next = 0;
+static int filter_count = 0;
+static joystickDirection filtered_direction = joy_rest;
+
+static bool readChannels(int *x, int *y, uint64_t *timestamp_ns);
+static void *sampler_main(void *arg);
+
+// initialize the joystick spi communication and start sampling
+bool joystick_initialize(int sample_rate_hz)
 {
     // open spi device
     spi_fd = open(SPI_DEVICE, O_RDWR);
@@ -44,78 +108,308 @@ bool joystick_initialize(void)
         perror("SPI set speed failed");
     }
 
-    printf("Joystick initialized.\n");
+    if (sample_rate_hz <= 0)
+        sample_rate_hz = JOYSTICK_DEFAULT_RATE_HZ;
+    initial_period_ns = 1000000000L / sample_rate_hz;
+    atomic_store(&sample_period_ns, initial_period_ns);
+
+    filter_next = 0;
+    filter_count = 0;
+    filter_sum_x = 0;
+    filter_sum_y = 0;
+    filtered_direction = joy_rest;
+    atomic_store(&state_sequence, 0);
+    atomic_store(&state_x, JOYSTICK_CENTER);
+    atomic_store(&state_y, JOYSTICK_CENTER);
+    atomic_store(&state_direction, joy_rest);
+    atomic_store(&state_samples, 0);
+    atomic_store(&state_timestamp, 0);
+    atomic_store(&state_changed_sample, 0);
+    atomic_store(&state_changed_ns, 0);
+    atomic_store(&change_head, 0);
+    atomic_store(&change_tail, 0);
+    changes_dropped = 0;
+    atomic_store(&sampler_stop, false);
+
+    change_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (change_fd < 0)
+        perror("Joystick eventfd failed");
+
+    if (pthread_create(&sampler_thread, NULL, sampler_main, NULL) != 0)
+    {
+        fprintf(stderr, "Joystick sampler thread failed to start\n");
+        if (change_fd >= 0)
+            close(change_fd);
+        change_fd = -1;
+        close(spi_fd);
+        spi_fd = -1;
+        return false;
+    }
+    sampler_running = true;
+
+    printf("Joystick initialized (sampling at %d Hz, %dx oversampled).\n",
+           sample_rate_hz, JOYSTICK_OVERSAMPLE);
     return true;
 }
 
-// read joystick position and determine direction
-joystickDirection joystick_getDirection(void)
+// direction of a filtered position, keeping the current one until it is
+// released (X-axis first, as it controls forward/backward)
+static joystickDirection decide_direction(int x, int y, joystickDirection current)
 {
-    int x = readChannel(0);
-    int y = readChannel(1);
+    int dx = x - JOYSTICK_CENTER;
+    int dy = y - JOYSTICK_CENTER;
 
-    // MCP3208 gives 12-bit values (0-4095)
-    // Center is ~2048, threshold for direction detection
-    const int CENTER = 2048;
-    const int THRESHOLD = 800; // Adjust this if too sensitive/insensitive
+    switch (current)
+    {
+    case joy_up:
+        if (dx > JOYSTICK_RELEASE_THRESHOLD)
+            return joy_up;
+        break;
+    case joy_down:
+        if (dx < -JOYSTICK_RELEASE_THRESHOLD)
+            return joy_down;
+        break;
+    case joy_left:
+        if (dy > JOYSTICK_RELEASE_THRESHOLD)
+            return joy_left;
+        break;
+    case joy_right:
+        if (dy < -JOYSTICK_RELEASE_THRESHOLD)
+            return joy_right;
+        break;
+    case joy_rest:
+        break;
+    }
 
-    // X-axis controls forward/backward
     // X up (forward) is ~4095, X down (backward) is ~0
-    if (x > CENTER + THRESHOLD)
+    if (dx > JOYSTICK_ENTER_THRESHOLD)
+        return joy_up;
+    if (dx < -JOYSTICK_ENTER_THRESHOLD)
+        return joy_down;
+
+    // Y left is ~4095, Y right is ~0
+    if (dy > JOYSTICK_ENTER_THRESHOLD)
+        return joy_left;
+    if (dy < -JOYSTICK_ENTER_THRESHOLD)
+        return joy_right;
+
+    return joy_rest;
+}
+
+// sampler thread: append a change of filtered_direction for the reader
+static void queue_change(unsigned long sample, uint64_t timestamp_ns)
+{
+    unsigned head = atomic_load_explicit(&change_head, memory_order_relaxed);
+    unsigned tail = atomic_load_explicit(&change_tail, memory_order_acquire);
+    if (head - tail >= JOYSTICK_CHANGE_QUEUE)
     {
-        return joy_up; // Forward
+        changes_dropped++;
+        return;
     }
-    if (x < CENTER - THRESHOLD)
+
+    JoystickChange *change = &change_queue[head % JOYSTICK_CHANGE_QUEUE];
+    change->direction = filtered_direction;
+    change->sample = sample;
+    change->timestamp_ns = timestamp_ns;
+    atomic_store_explicit(&change_head, head + 1, memory_order_release);
+}
+
+// sampler thread: feed one oversampled reading through the filter and publish
+static void publish_sample(int x, int y, uint64_t timestamp_ns)
+{
+    filter_sum_x += x - (filter_count == JOYSTICK_FILTER_TAPS ? filter_x[filter_next] : 0);
+    filter_sum_y += y - (filter_count == JOYSTICK_FILTER_TAPS ? filter_y[filter_next] : 0);
+    filter_x[filter_next] = x;
+    filter_y[filter_next] = y;
+    filter_next = (filter_next + 1) % JOYSTICK_FILTER_TAPS;
+    if (filter_count < JOYSTICK_FILTER_TAPS)
+        filter_count++;
+
+    int avg_x = filter_sum_x / filter_count;
+    int avg_y = filter_sum_y / filter_count;
+    joystickDirection previous = filtered_direction;
+    filtered_direction = decide_direction(avg_x, avg_y, filtered_direction);
+
+    unsigned seq = atomic_load_explicit(&state_sequence, memory_order_relaxed);
+    atomic_store_explicit(&state_sequence, seq + 1, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+
+    atomic_store_explicit(&state_x, avg_x, memory_order_relaxed);
+    atomic_store_explicit(&state_y, avg_y, memory_order_relaxed);
+    atomic_store_explicit(&state_direction, filtered_direction, memory_order_relaxed);
+    unsigned long sample = atomic_fetch_add_explicit(&state_samples, 1, memory_order_relaxed) + 1;
+    atomic_store_explicit(&state_timestamp, timestamp_ns, memory_order_relaxed);
+    if (filtered_direction != previous)
     {
-        return joy_down; // Backward
+        atomic_store_explicit(&state_changed_sample, sample, memory_order_relaxed);
+        atomic_store_explicit(&state_changed_ns, timestamp_ns, memory_order_relaxed);
     }
 
-    // Y-axis controls left/right
-    // Y left is ~4095, Y right is ~0
-    if (y > CENTER + THRESHOLD)
+    atomic_store_explicit(&state_sequence, seq + 2, memory_order_release);
+
+    if (filtered_direction != previous)
+        queue_change(sample, timestamp_ns);
+
+    if (filtered_direction != previous && change_fd >= 0)
     {
-        return joy_left; // Left
+        uint64_t one = 1;
+        if (write(change_fd, &one, sizeof(one)) < 0)
+        {
+            // counter full: the reader has a change pending anyway
+        }
     }
-    if (y < CENTER - THRESHOLD)
+}
+
+static void *sampler_main(void *arg)
+{
+    (void)arg;
+
+    struct timespec next;
+    clock_gettime(CLOCK_MONOTONIC, &next);
+
+    while (!atomic_load(&sampler_stop))
     {
-        return joy_right; // Right
+        int x;
+        int y;
+        uint64_t timestamp_ns;
+        if (readChannels(&x, &y, &timestamp_ns))
+            publish_sample(x, y, timestamp_ns);
+
+        // absolute deadlines so the rate does not drift with the SPI time
+        next.tv_nsec += atomic_load_explicit(&sample_period_ns, memory_order_relaxed);
+        while (next.tv_nsec >= 1000000000L)
+        {
+            next.tv_nsec -= 1000000000L;
+            next.tv_sec++;
+        }
+        clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &next, NULL);
     }
 
-    return joy_rest;
+    return NULL;
+}
+
+bool joystick_read(JoystickState *state)
+{
+    if (!state || !sampler_running)
+        return false;
+
+    unsigned before;
+    unsigned after;
+    do
+    {
+        before = atomic_load_explicit(&state_sequence, memory_order_acquire);
+        state->x = atomic_load_explicit(&state_x, memory_order_relaxed);
+        state->y = atomic_load_explicit(&state_y, memory_order_relaxed);
+        state->direction = (joystickDirection)atomic_load_explicit(&state_direction, memory_order_relaxed);
+        state->samples = atomic_load_explicit(&state_samples, memory_order_relaxed);
+        state->timestamp_ns = atomic_load_explicit(&state_timestamp, memory_order_relaxed);
+        state->changed_sample = atomic_load_explicit(&state_changed_sample, memory_order_relaxed);
+        state->changed_ns = atomic_load_explicit(&state_changed_ns, memory_order_relaxed);
+        atomic_thread_fence(memory_order_acquire);
+        after = atomic_load_explicit(&state_sequence, memory_order_relaxed);
+    } while ((before & 1) != 0 || before != after);
+
+    return true;
+}
+
+bool joystick_take_change(JoystickChange *change)
+{
+    if (!change || !sampler_running)
+        return false;
+
+    unsigned tail = atomic_load_explicit(&change_tail, memory_order_relaxed);
+    unsigned head = atomic_load_explicit(&change_head, memory_order_acquire);
+    if (tail == head)
+        return false;
+
+    *change = change_queue[tail % JOYSTICK_CHANGE_QUEUE];
+    atomic_store_explicit(&change_tail, tail + 1, memory_order_release);
+    return true;
+}
+
+// latest filtered direction, no SPI access
+joystickDirection joystick_getDirection(void)
+{
+    JoystickState state;
+    if (!joystick_read(&state))
+        return joy_rest;
+
+    return state.direction;
+}
+
+int joystick_get_fd(void)
+{
+    return change_fd;
 }
 
-// close spi device when finished
+void joystick_set_rate(int sample_rate_hz)
+{
+    long period_ns = sample_rate_hz > 0 ? 1000000000L / sample_rate_hz : initial_period_ns;
+    atomic_store_explicit(&sample_period_ns, period_ns, memory_order_relaxed);
+}
+
+// stop sampling and close spi device when finished
 void joystick_cleanup(void)
 {
+    if (sampler_running)
+    {
+        atomic_store(&sampler_stop, true);
+        pthread_join(sampler_thread, NULL);
+        sampler_running = false;
+        printf("Joystick: %lu samples taken, %lu direction changes dropped\n",
+               (unsigned long)atomic_load(&state_samples), changes_dropped);
+    }
+
+    if (change_fd >= 0)
+        close(change_fd);
+    change_fd = -1;
+
     if (spi_fd >= 0)
         close(spi_fd);
     spi_fd = -1;
 }
 
-// read adc channel from the chip using spi
-static int readChannel(int channel)
+// read both adc channels JOYSTICK_OVERSAMPLE times in one spi message and
+// average each channel; timestamp_ns gets the time the message completed
+static bool readChannels(int *x, int *y, uint64_t *timestamp_ns)
 {
-    // prepare spi transmit buffer
-    uint8_t tx[3], rx[3];
-    tx[0] = MCP3208_READ_CMD | ((channel & 0x07) >> 2);
-    tx[1] = ((channel & 0x07) << 6);
-    tx[2] = 0;
-
-    // transfer structure
-    struct spi_ioc_transfer tr = {
-        .tx_buf = (unsigned long)tx,
-        .rx_buf = (unsigned long)rx,
-        .len = 3,
-        .speed_hz = SPI_SPEED,
-        .bits_per_word = 8,
-    };
-
-    if (ioctl(spi_fd, SPI_IOC_MESSAGE(1), &tr) < 1)
+    // prepare spi transmit buffers: channel 0 and 1 alternating, chip
+    // select released between conversions (cs_change)
+    uint8_t tx[JOYSTICK_TRANSFERS][3];
+    uint8_t rx[JOYSTICK_TRANSFERS][3];
+    struct spi_ioc_transfer tr[JOYSTICK_TRANSFERS] = {0};
+
+    for (int i = 0; i < JOYSTICK_TRANSFERS; i++)
+    {
+        int channel = i & 1;
+        tx[i][0] = MCP3208_READ_CMD | ((channel & 0x07) >> 2);
+        tx[i][1] = ((channel & 0x07) << 6);
+        tx[i][2] = 0;
+
+        tr[i].tx_buf = (unsigned long)tx[i];
+        tr[i].rx_buf = (unsigned long)rx[i];
+        tr[i].len = 3;
+        tr[i].speed_hz = SPI_SPEED;
+        tr[i].bits_per_word = 8;
+        tr[i].cs_change = i + 1 < JOYSTICK_TRANSFERS;
+    }
+
+    if (ioctl(spi_fd, SPI_IOC_MESSAGE(JOYSTICK_TRANSFERS), tr) < 1)
     {
         perror("SPI read failed");
-        return -1;
+        return false;
     }
 
-    // combine received bytes into a 12-bit adc value
-    return ((rx[1] & 0x0F) << 8) | rx[2];
-}
\ No newline at end of file
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    *timestamp_ns = (uint64_t)now.tv_sec * 1000000000ull + (uint64_t)now.tv_nsec;
+
+    // combine received bytes into 12-bit adc values
+    int sum[2] = {0, 0};
+    for (int i = 0; i < JOYSTICK_TRANSFERS; i++)
+        sum[i & 1] += ((rx[i][1] & 0x0F) << 8) | rx[i][2];
+
+    *x = sum[0] / JOYSTICK_OVERSAMPLE;
+    *y = sum[1] / JOYSTICK_OVERSAMPLE;
+    return true;
+}
@@ -0,0 +1,219 @@
+#include "residency.h"
+#include "image.h"
+#include <stdio.h>
+#include <string.h>
+
+#define RESIDENCY_MAX_TEXTURES 64
+#define RESIDENCY_PATH_MAX 128
+
+typedef struct {
+    char path[RESIDENCY_PATH_MAX];
+    int logical_w;
+    int logical_h;
+    SDL_Texture* texture;      // NULL while evicted
+    size_t bytes;
+    Uint32 last_used;          // LRU stamp
+    Uint32 last_frame;         // frame of the last acquire
+} ResidentEntry;
+
+static SDL_Renderer* residency_renderer = NULL;
+static ResidentEntry entries[RESIDENCY_MAX_TEXTURES];
+static int entry_count = 0;
+static Uint32 use_clock = 0;
+static Uint32 frame_number = 1;
+static ResidencyStats stats = {0};
+
+static void update_peak(void) {
+    size_t total = stats.resident_bytes + stats.tracked_bytes;
+    if (total > stats.peak_bytes) {
+        stats.peak_bytes = total;
+    }
+}
+
+static void unload(ResidentEntry* e) {
+    SDL_DestroyTexture(e->texture);
+    e->texture = NULL;
+    stats.resident_bytes -= e->bytes;
+    stats.resident_count--;
+    e->bytes = 0;
+}
+
+// evicts least recently used textures until bytes more fit in the budget;
+// textures used this frame stay, so the budget may be overrun for a frame
+static void make_room(size_t bytes) {
+    while (stats.resident_bytes + bytes > stats.budget_bytes) {
+        ResidentEntry* victim = NULL;
+        for (int i = 0; i < entry_count; i++) {
+            ResidentEntry* e = &entries[i];
+            if (e->texture && e->last_frame != frame_number &&
+                (!victim || e->last_used < victim->last_used)) {
+                victim = e;
+            }
+        }
+        if (!victim) {
+            return;
+        }
+
+        printf("Residency: Evicting '%s' (%zu KB)\n", victim->path, victim->bytes / 1024);
+        unload(victim);
+        stats.evictions++;
+    }
+}
+
+bool residency_init(SDL_Renderer* renderer, size_t budget_bytes) {
+    if (!renderer) {
+        fprintf(stderr, "Residency: Invalid renderer\n");
+        return false;
+    }
+
+    residency_renderer = renderer;
+    stats.budget_bytes = budget_bytes > 0 ? budget_bytes : RESIDENCY_DEFAULT_BUDGET;
+    printf("Residency: %zu KB budget\n", stats.budget_bytes / 1024);
+    return true;
+}
+
+ResidentTexture residency_register(const char* path, int logical_w, int logical_h) {
+    if (!path) {
+        return RESIDENT_NONE;
+    }
+
+    for (int i = 0; i < entry_count; i++) {
+        ResidentEntry* e = &entries[i];
+        if (e->logical_w == logical_w && e->logical_h == logical_h && strcmp(e->path, path) == 0) {
+            return i;
+        }
+    }
+
+    if (entry_count >= RESIDENCY_MAX_TEXTURES) {
+        fprintf(stderr, "Residency: Too many textures, cannot register '%s'\n", path);
+        return RESIDENT_NONE;
+    }
+
+    ResidentEntry* e = &entries[entry_count];
+    memset(e, 0, sizeof(*e));
+    snprintf(e->path, sizeof(e->path), "%s", path);
+    e->logical_w = logical_w;
+    e->logical_h = logical_h;
+    stats.registered_count = ++entry_count;
+    return entry_count - 1;
+}
+
+SDL_Texture* residency_acquire(ResidentTexture handle) {
+    if (handle < 0 || handle >= entry_count || !residency_renderer) {
+        return NULL;
+    }
+
+    ResidentEntry* e = &entries[handle];
+    e->last_used = ++use_clock;
+    e->last_frame = frame_number;
+
+    if (e->texture) {
+        return e->texture;
+    }
+
+    SDL_Texture* texture = image_load_texture(residency_renderer, e->path, e->logical_w, e->logical_h);
+    if (!texture) {
+        return NULL;
+    }
+
+    size_t bytes = residency_texture_bytes(texture);
+    make_room(bytes);
+
+    e->texture = texture;
+    e->bytes = bytes;
+    stats.resident_bytes += bytes;
+    stats.resident_count++;
+    stats.loads++;
+    update_peak();
+    return texture;
+}
+
+bool residency_adopt(ResidentTexture handle, SDL_Texture* texture) {
+    if (handle < 0 || handle >= entry_count || !texture) {
+        SDL_DestroyTexture(texture);
+        return false;
+    }
+
+    ResidentEntry* e = &entries[handle];
+    if (e->texture) {
+        SDL_DestroyTexture(texture);
+        return true;
+    }
+
+    size_t bytes = residency_texture_bytes(texture);
+    make_room(bytes);
+
+    // Counts as used now, so it outlives anything older in the LRU order
+    e->texture = texture;
+    e->bytes = bytes;
+    e->last_used = ++use_clock;
+    stats.resident_bytes += bytes;
+    stats.resident_count++;
+    stats.loads++;
+    update_peak();
+    return true;
+}
+
+bool residency_is_resident(ResidentTexture handle) {
+    return handle >= 0 && handle < entry_count && entries[handle].texture != NULL;
+}
+
+const char* residency_get_source(ResidentTexture handle, int* logical_w, int* logical_h) {
+    if (handle < 0 || handle >= entry_count) {
+        return NULL;
+    }
+    if (logical_w) *logical_w = entries[handle].logical_w;
+    if (logical_h) *logical_h = entries[handle].logical_h;
+    return entries[handle].path;
+}
+
+void residency_evict(ResidentTexture handle) {
+    if (handle >= 0 && handle < entry_count && entries[handle].texture) {
+        unload(&entries[handle]);
+        stats.evictions++;
+    }
+}
+
+void residency_begin_frame(void) {
+    frame_number++;
+}
+
+size_t residency_texture_bytes(SDL_Texture* texture) {
+    Uint32 format = 0;
+    int w = 0;
+    int h = 0;
+    if (!texture || SDL_QueryTexture(texture, &format, NULL, &w, &h) != 0) {
+        return 0;
+    }
+    return (size_t)w * (size_t)h * SDL_BYTESPERPIXEL(format);
+}
+
+void residency_track(SDL_Texture* texture) {
+    stats.tracked_bytes += residency_texture_bytes(texture);
+    update_peak();
+}
+
+void residency_untrack(SDL_Texture* texture) {
+    size_t bytes = residency_texture_bytes(texture);
+    stats.tracked_bytes = bytes < stats.tracked_bytes ? stats.tracked_bytes - bytes : 0;
+}
+
+void residency_get_stats(ResidencyStats* out) {
+    if (out) {
+        *out = stats;
+    }
+}
+
+void residency_cleanup(void) {
+    printf("Residency: %lu loads, %lu evictions, peak %zu KB (budget %zu KB)\n",
+           stats.loads, stats.evictions, stats.peak_bytes / 1024, stats.budget_bytes / 1024);
+
+    for (int i = 0; i < entry_count; i++) {
+        if (entries[i].texture) {
+            unload(&entries[i]);
+        }
+    }
+    entry_count = 0;
+    stats.registered_count = 0;
+    residency_renderer = NULL;
+}
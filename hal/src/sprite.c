@@ -1,6 +1,67 @@
 #include "sprite.h"
-#include <SDL2/SDL_image.h>
+#include "atlas.h"
+#include "image.h"
+#include "residency.h"
 #include <stdio.h>
+#include <string.h>
+
+#define SPRITE_BATCH_MAX_QUADS 256
+#define SPRITE_CACHE_MAX 64
+#define SPRITE_PATH_MAX 128
+
+typedef struct {
+    char path[SPRITE_PATH_MAX];
+    SDL_Texture* texture;
+    SDL_Rect src;          // texels inside texture
+    int width;             // logical size
+    int height;
+    int refcount;          // 0 = free slot
+    bool owns_texture;     // false for atlas regions
+} SpriteCacheEntry;
+
+static SpriteCacheEntry sprite_cache[SPRITE_CACHE_MAX];
+
+// Pending batch state
+static SDL_Renderer* batch_renderer = NULL;
+static SDL_Texture* batch_texture = NULL;
+static float batch_tex_w = 1.0f;
+static float batch_tex_h = 1.0f;
+static SDL_Vertex batch_vertices[SPRITE_BATCH_MAX_QUADS * 4];
+static int batch_indices[SPRITE_BATCH_MAX_QUADS * 6];
+static int batch_quads = 0;
+
+// ----------------------------------------------------
+// Shared texture cache (keyed by path, reference counted)
+// ----------------------------------------------------
+static int cache_find(const char* path) {
+    for (int i = 0; i < SPRITE_CACHE_MAX; i++) {
+        if (sprite_cache[i].refcount > 0 && strcmp(sprite_cache[i].path, path) == 0) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+static int cache_free_slot(void) {
+    for (int i = 0; i < SPRITE_CACHE_MAX; i++) {
+        if (sprite_cache[i].refcount == 0) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+// hands out a new reference of cache entry id
+static void sprite_from_cache(Sprite* sprite, int id) {
+    SpriteCacheEntry* e = &sprite_cache[id];
+    e->refcount++;
+
+    sprite->texture = e->texture;
+    sprite->src = e->src;
+    sprite->width = e->width;
+    sprite->height = e->height;
+    sprite->cache_ref = id + 1;
+}
 
 // loads the an image and creates the sprite
 bool sprite_load(Sprite* sprite, SDL_Renderer* renderer, const char* filename) {
@@ -9,29 +70,63 @@ bool sprite_load(Sprite* sprite, SDL_Renderer* renderer, const char* filename) {
         return false;
     }
 
-    // Load image as surface
-    SDL_Surface* surface = IMG_Load(filename);
-    if (!surface) {
-        fprintf(stderr, "Sprite: Failed to load '%s': %s\n", filename, IMG_GetError());
-        return false;
+    sprite->cache_ref = 0;
+
+    // Already loaded: share the texture, no disk access
+    int id = cache_find(filename);
+    if (id >= 0) {
+        sprite_from_cache(sprite, id);
+        return true;
     }
 
-    // Create texture from surface
-    sprite->texture = SDL_CreateTextureFromSurface(renderer, surface);
-    if (!sprite->texture) {
-        fprintf(stderr, "Sprite: Failed to create texture: %s\n", SDL_GetError());
-        SDL_FreeSurface(surface);
+    id = cache_free_slot();
+    if (id < 0) {
+        fprintf(stderr, "Sprite: Cache full, cannot load '%s'\n", filename);
         return false;
     }
+    SpriteCacheEntry* e = &sprite_cache[id];
+
+    // Packed images share the atlas texture
+    AtlasRegion region;
+    if (atlas_find(filename, &region)) {
+        e->texture = region.texture;
+        e->src = region.rect;
+        e->width = region.width;
+        e->height = region.height;
+        e->owns_texture = false;
+    } else {
+        // Load image as surface, pre-scaled to the output resolution
+        SDL_Surface* surface = image_load_surface(filename);
+        if (!surface) {
+            return false;
+        }
+        e->width = surface->w;
+        e->height = surface->h;
+        surface = image_fit_output(renderer, surface, e->width, e->height);
+
+        // Create texture from surface
+        e->texture = image_create_texture(renderer, surface);
+        if (!e->texture) {
+            fprintf(stderr, "Sprite: Failed to create texture: %s\n", SDL_GetError());
+            SDL_FreeSurface(surface);
+            return false;
+        }
+
+        // Store dimensions
+        e->src = (SDL_Rect){0, 0, surface->w, surface->h};
+        e->owns_texture = true;
+        residency_track(e->texture);
 
-    // Store dimensions
-    sprite->width = surface->w;
-    sprite->height = surface->h;
+        // Free surface (we only need the texture now)
+        SDL_FreeSurface(surface);
 
-    // Free surface (we only need the texture now)
-    SDL_FreeSurface(surface);
+        printf("Sprite: Loaded '%s' (%dx%d, %dx%d texels)\n",
+               filename, e->width, e->height, e->src.w, e->src.h);
+    }
 
-    printf("Sprite: Loaded '%s' (%dx%d)\n", filename, sprite->width, sprite->height);
+    snprintf(e->path, sizeof(e->path), "%s", filename);
+    e->refcount = 0;
+    sprite_from_cache(sprite, id);
     return true;
 }
 
@@ -48,7 +143,7 @@ void sprite_render(Sprite* sprite, SDL_Renderer* renderer, int x, int y) {
         .h = sprite->height
     };
 
-    SDL_RenderCopy(renderer, sprite->texture, NULL, &dest);
+    SDL_RenderCopy(renderer, sprite->texture, &sprite->src, &dest);
 }
 
 // renders the sprite with custom dimensions at a specific position 
@@ -64,7 +159,7 @@ void sprite_render_scaled(Sprite* sprite, SDL_Renderer* renderer, int x, int y,
         .h = h
     };
 
-    SDL_RenderCopy(renderer, sprite->texture, NULL, &dest);
+    SDL_RenderCopy(renderer, sprite->texture, &sprite->src, &dest);
 }
 
 // renders a portion of the sprite for animation frames
@@ -80,20 +175,153 @@ void sprite_render_clip(Sprite* sprite, SDL_Renderer* renderer, int x, int y, SD
         .h = clip ? clip->h : sprite->height
     };
 
-    SDL_RenderCopy(renderer, sprite->texture, clip, &dest);
+    // clip is in the sprite's logical pixels, relative to the sprite rather
+    // than to the (atlas, pre-scaled) texture
+    SDL_Rect src = sprite->src;
+    if (clip && sprite->width > 0 && sprite->height > 0) {
+        src.x += clip->x * sprite->src.w / sprite->width;
+        src.y += clip->y * sprite->src.h / sprite->height;
+        src.w = clip->w * sprite->src.w / sprite->width;
+        src.h = clip->h * sprite->src.h / sprite->height;
+    }
+
+    SDL_RenderCopy(renderer, sprite->texture, &src, &dest);
 }
 
-// frees sprite resources and resets sprite data
+// releases the sprite's reference and resets sprite data
 void sprite_free(Sprite* sprite) {
     if (!sprite) {
         return;
     }
 
-    if (sprite->texture) {
-        SDL_DestroyTexture(sprite->texture);
-        sprite->texture = NULL;
+    int id = sprite->cache_ref - 1;
+    if (id >= 0 && id < SPRITE_CACHE_MAX && sprite_cache[id].refcount > 0) {
+        SpriteCacheEntry* e = &sprite_cache[id];
+        e->refcount--;
+
+        // Last reference gone; atlas regions are owned by the atlas
+        if (e->refcount == 0) {
+            if (e->owns_texture && e->texture) {
+                residency_untrack(e->texture);
+                SDL_DestroyTexture(e->texture);
+            }
+            e->texture = NULL;
+            e->path[0] = '\0';
+        }
     }
 
+    sprite->texture = NULL;
+    sprite->cache_ref = 0;
     sprite->width = 0;
     sprite->height = 0;
-}
\ No newline at end of file
+}
+
+// ----------------------------------------------------
+// Batching
+// ----------------------------------------------------
+static void batch_flush(void) {
+    if (batch_quads > 0 && batch_renderer) {
+        if (SDL_RenderGeometry(batch_renderer, batch_texture,
+                               batch_vertices, batch_quads * 4,
+                               batch_indices, batch_quads * 6) < 0) {
+            fprintf(stderr, "Sprite: Batch submit failed: %s\n", SDL_GetError());
+        }
+    }
+    batch_quads = 0;
+}
+
+// queues one textured quad, flushing when the texture changes
+static void batch_add_quad(SDL_Texture* texture, const SDL_Rect* src,
+                           const SDL_Rect* dst, SDL_Color color) {
+    if (texture != batch_texture || batch_quads == SPRITE_BATCH_MAX_QUADS) {
+        batch_flush();
+
+        if (texture != batch_texture) {
+            int w = 1;
+            int h = 1;
+            SDL_QueryTexture(texture, NULL, NULL, &w, &h);
+            batch_texture = texture;
+            batch_tex_w = (float)w;
+            batch_tex_h = (float)h;
+        }
+    }
+
+    float u0 = src->x / batch_tex_w;
+    float v0 = src->y / batch_tex_h;
+    float u1 = (src->x + src->w) / batch_tex_w;
+    float v1 = (src->y + src->h) / batch_tex_h;
+    float x0 = (float)dst->x;
+    float y0 = (float)dst->y;
+    float x1 = (float)(dst->x + dst->w);
+    float y1 = (float)(dst->y + dst->h);
+
+    SDL_Vertex* v = &batch_vertices[batch_quads * 4];
+    v[0] = (SDL_Vertex){{x0, y0}, color, {u0, v0}};
+    v[1] = (SDL_Vertex){{x1, y0}, color, {u1, v0}};
+    v[2] = (SDL_Vertex){{x1, y1}, color, {u1, v1}};
+    v[3] = (SDL_Vertex){{x0, y1}, color, {u0, v1}};
+
+    int base = batch_quads * 4;
+    int* idx = &batch_indices[batch_quads * 6];
+    idx[0] = base;
+    idx[1] = base + 1;
+    idx[2] = base + 2;
+    idx[3] = base;
+    idx[4] = base + 2;
+    idx[5] = base + 3;
+
+    batch_quads++;
+}
+
+void sprite_batch_begin(SDL_Renderer* renderer) {
+    batch_renderer = renderer;
+    batch_texture = NULL;
+    batch_quads = 0;
+}
+
+void sprite_batch_draw(Sprite* sprite, SDL_Renderer* renderer, int x, int y) {
+    if (!sprite || !sprite->texture || !renderer) {
+        return;
+    }
+
+    // Outside a batch, draw immediately
+    if (renderer != batch_renderer) {
+        sprite_render(sprite, renderer, x, y);
+        return;
+    }
+
+    SDL_Rect dst = {x, y, sprite->width, sprite->height};
+    SDL_Color white = {255, 255, 255, 255};
+    batch_add_quad(sprite->texture, &sprite->src, &dst, white);
+}
+
+void sprite_batch_fill_rect(SDL_Renderer* renderer, const SDL_Rect* rect, SDL_Color color) {
+    if (!rect || !renderer) {
+        return;
+    }
+
+    if (renderer != batch_renderer) {
+        SDL_SetRenderDrawColor(renderer, color.r, color.g, color.b, color.a);
+        SDL_RenderFillRect(renderer, rect);
+        return;
+    }
+
+    // Solid quads sample the atlas' white block so they stay in the batch
+    AtlasRegion white;
+    if (atlas_get_white_region(&white)) {
+        // sample the middle of the block only
+        SDL_Rect src = {white.rect.x + 1, white.rect.y + 1, white.rect.w - 2, white.rect.h - 2};
+        batch_add_quad(white.texture, &src, rect, color);
+        return;
+    }
+
+    batch_flush();
+    SDL_SetRenderDrawColor(batch_renderer, color.r, color.g, color.b, color.a);
+    SDL_RenderFillRect(batch_renderer, rect);
+}
+
+void sprite_batch_end(void) {
+    batch_flush();
+    batch_renderer = NULL;
+    batch_texture = NULL;
+}
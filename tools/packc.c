@@ -0,0 +1,233 @@
+// packc: writes every asset into one pack file (see hal/asset_pack.h).
+// Files named in the order file come first, in that order, so that startup
+// reads the pack front to back; the rest follow sorted by path. Source images
+// that have a compiled texture blob are left out, the game only reads the blob.
+//
+// Usage: packc <output> <order file> <assets dir>...
+// Each assets dir is stored under the "assets/" prefix the game opens files by.
+
+#define _POSIX_C_SOURCE 200809L
+
+#include "asset_pack.h"
+#include "image.h"
+#include <dirent.h>
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+
+#define PACK_MAX_FILES 512
+#define PACK_SOURCE_MAX 512
+
+typedef struct {
+    char path[ASSET_PACK_PATH_MAX];
+    char source[PACK_SOURCE_MAX];
+    long size;
+    int order;                 // line in the order file, INT_MAX when absent
+    Uint32 offset;
+} PackFile;
+
+static PackFile files[PACK_MAX_FILES];
+static int file_count = 0;
+
+static PackFile* find_file(const char* path) {
+    for (int i = 0; i < file_count; i++) {
+        if (strcmp(files[i].path, path) == 0) {
+            return &files[i];
+        }
+    }
+    return NULL;
+}
+
+// adds every regular file below dir, stored as prefix/<relative path>
+static bool collect(const char* dir, const char* prefix) {
+    DIR* d = opendir(dir);
+    if (!d) {
+        fprintf(stderr, "packc: Cannot open '%s'\n", dir);
+        return false;
+    }
+
+    bool ok = true;
+    struct dirent* ent;
+    while (ok && (ent = readdir(d)) != NULL) {
+        if (strcmp(ent->d_name, ".") == 0 || strcmp(ent->d_name, "..") == 0) {
+            continue;
+        }
+
+        char source[PACK_SOURCE_MAX];
+        char path[ASSET_PACK_PATH_MAX];
+        struct stat st;
+        if (snprintf(source, sizeof(source), "%s/%s", dir, ent->d_name) >= (int)sizeof(source) ||
+            snprintf(path, sizeof(path), "%s/%s", prefix, ent->d_name) >= (int)sizeof(path)) {
+            fprintf(stderr, "packc: Path too long: '%s/%s'\n", prefix, ent->d_name);
+            ok = false;
+            break;
+        }
+        if (stat(source, &st) != 0) {
+            continue;
+        }
+
+        if (S_ISDIR(st.st_mode)) {
+            ok = collect(source, path);
+            continue;
+        }
+        if (!S_ISREG(st.st_mode)) {
+            continue;
+        }
+
+        // A later assets dir overrides an earlier one
+        PackFile* f = find_file(path);
+        if (!f) {
+            if (file_count >= PACK_MAX_FILES) {
+                fprintf(stderr, "packc: Too many files\n");
+                ok = false;
+                break;
+            }
+            f = &files[file_count++];
+            snprintf(f->path, sizeof(f->path), "%s", path);
+        }
+        snprintf(f->source, sizeof(f->source), "%s", source);
+        f->size = (long)st.st_size;
+        f->order = INT_MAX;
+    }
+
+    closedir(d);
+    return ok;
+}
+
+static void read_order(const char* order_path) {
+    FILE* file = fopen(order_path, "r");
+    if (!file) {
+        fprintf(stderr, "packc: No order file '%s', packing by path\n", order_path);
+        return;
+    }
+
+    char line[ASSET_PACK_PATH_MAX + 2];
+    int position = 0;
+    while (fgets(line, sizeof(line), file)) {
+        line[strcspn(line, "\r\n")] = '\0';
+        if (line[0] == '\0' || line[0] == '#') {
+            continue;
+        }
+
+        PackFile* f = find_file(line);
+        if (f && f->order == INT_MAX) {
+            f->order = position++;
+        }
+    }
+
+    fclose(file);
+}
+
+// drops source images whose blob is packed as well
+static void drop_blob_sources(void) {
+    int kept = 0;
+    for (int i = 0; i < file_count; i++) {
+        char blob[ASSET_PACK_PATH_MAX + sizeof(IMAGE_BLOB_SUFFIX)];
+        snprintf(blob, sizeof(blob), "%s%s", files[i].path, IMAGE_BLOB_SUFFIX);
+        if (!find_file(blob)) {
+            files[kept++] = files[i];
+        }
+    }
+    file_count = kept;
+}
+
+static int compare_files(const void* a, const void* b) {
+    const PackFile* fa = a;
+    const PackFile* fb = b;
+    if (fa->order != fb->order) {
+        return fa->order < fb->order ? -1 : 1;
+    }
+    return strcmp(fa->path, fb->path);
+}
+
+static Uint32 align_up(Uint32 value) {
+    return (value + ASSET_PACK_ALIGN - 1) & ~(Uint32)(ASSET_PACK_ALIGN - 1);
+}
+
+static bool copy_file(FILE* out, const PackFile* f) {
+    FILE* in = fopen(f->source, "rb");
+    if (!in) {
+        fprintf(stderr, "packc: Cannot read '%s'\n", f->source);
+        return false;
+    }
+
+    char buffer[64 * 1024];
+    long copied = 0;
+    size_t n;
+    while ((n = fread(buffer, 1, sizeof(buffer), in)) > 0) {
+        if (fwrite(buffer, 1, n, out) != n) {
+            break;
+        }
+        copied += (long)n;
+    }
+
+    fclose(in);
+    return copied == f->size;
+}
+
+int main(int argc, char* argv[]) {
+    if (argc < 4) {
+        fprintf(stderr, "Usage: %s <output> <order file> <assets dir>...\n", argv[0]);
+        return 2;
+    }
+
+    for (int i = 3; i < argc; i++) {
+        if (!collect(argv[i], "assets")) {
+            return 1;
+        }
+    }
+    drop_blob_sources();
+    read_order(argv[2]);
+    qsort(files, file_count, sizeof(files[0]), compare_files);
+
+    // Lay the files out behind the index
+    Uint32 offset = align_up((Uint32)(sizeof(AssetPackHeader) + file_count * sizeof(AssetPackEntry)));
+    Uint32 data_offset = offset;
+    for (int i = 0; i < file_count; i++) {
+        files[i].offset = offset;
+        offset = align_up(offset + (Uint32)files[i].size);
+    }
+
+    FILE* out = fopen(argv[1], "wb");
+    if (!out) {
+        fprintf(stderr, "packc: Cannot write '%s'\n", argv[1]);
+        return 1;
+    }
+
+    AssetPackHeader header;
+    memcpy(header.magic, ASSET_PACK_MAGIC, 4);
+    header.version = SDL_SwapLE16(ASSET_PACK_VERSION);
+    header.reserved = 0;
+    header.entry_count = SDL_SwapLE32((Uint32)file_count);
+    header.data_offset = SDL_SwapLE32(data_offset);
+    bool ok = fwrite(&header, sizeof(header), 1, out) == 1;
+
+    for (int i = 0; i < file_count && ok; i++) {
+        AssetPackEntry entry;
+        memset(&entry, 0, sizeof(entry));
+        snprintf(entry.path, sizeof(entry.path), "%s", files[i].path);
+        entry.offset = SDL_SwapLE32(files[i].offset);
+        entry.size = SDL_SwapLE32((Uint32)files[i].size);
+        ok = fwrite(&entry, sizeof(entry), 1, out) == 1;
+    }
+
+    for (int i = 0; i < file_count && ok; i++) {
+        ok = fseek(out, files[i].offset, SEEK_SET) == 0 && copy_file(out, &files[i]);
+    }
+
+    // Pad the tail so the last file also ends on the alignment
+    if (ok && file_count > 0 && (Uint32)ftell(out) < offset) {
+        ok = fseek(out, offset - 1, SEEK_SET) == 0 && fputc(0, out) != EOF;
+    }
+
+    if (fclose(out) != 0 || !ok) {
+        fprintf(stderr, "packc: Failed writing '%s'\n", argv[1]);
+        remove(argv[1]);
+        return 1;
+    }
+
+    printf("packc: %d files, %u KB -> %s\n", file_count, offset / 1024, argv[1]);
+    return 0;
+}
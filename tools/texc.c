@@ -0,0 +1,32 @@
+// texc: asset compiler that turns an image into a pre-decoded texture blob
+// (premultiplied IMAGE_NATIVE_FORMAT pixels behind a small header), so the
+// game can skip image decoding at startup.
+//
+// Usage: texc <input image> <output blob>
+
+#include "image.h"
+#include <SDL2/SDL_image.h>
+#include <stdio.h>
+
+int main(int argc, char* argv[]) {
+    if (argc != 3) {
+        fprintf(stderr, "Usage: %s <input image> <output blob>\n", argv[0]);
+        return 2;
+    }
+
+    int formats = IMG_INIT_PNG | IMG_INIT_JPG | IMG_INIT_WEBP;
+    if ((IMG_Init(formats) & formats) != formats) {
+        fprintf(stderr, "texc: Some image formats are unavailable: %s\n", IMG_GetError());
+    }
+
+    SDL_Surface* surface = image_decode_file(argv[1]);
+    bool ok = surface && image_write_blob(argv[2], surface);
+
+    if (ok) {
+        printf("texc: %s -> %s (%dx%d)\n", argv[1], argv[2], surface->w, surface->h);
+    }
+
+    SDL_FreeSurface(surface);
+    IMG_Quit();
+    return ok ? 0 : 1;
+}